@@ -0,0 +1,363 @@
+/*
+ * Throughput benchmark for the reader, stream decoder and writers.
+ *
+ * Usage: bench [-n Count] [-t Seconds] [-c Chunk,Chunk,...] [Corpus ...]
+ *
+ * Generates each corpus (ints, floats, strings, nested, blobs) with about Count data items,
+ * then reports MB/s and million items/s for minicbor_read() and minicbor_next() with the input fed in blocks of each chunk size
+ * (0 for the whole document at once), and for the minicbor_write_*() and minicbor_buffer_write_*() functions.
+ * Each figure is the best of 4 rounds lasting at least Seconds / 4 each.
+ */
+
+#include "minicbor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CORPUS_DEPTH 32
+#define CORPUS_BLOB 65536
+
+typedef struct {
+	const char *Chars;
+	size_t Length;
+} corpus_string_t;
+
+typedef struct {
+	size_t Count;
+	int64_t *Integers;
+	double *Reals;
+	corpus_string_t *Strings;
+	corpus_string_t Keys[4];
+	unsigned char *Blob;
+} corpus_data_t;
+
+typedef struct {
+	unsigned char *Bytes;
+	size_t Size, Capacity;
+} output_t;
+
+static uint64_t RandomState = 0x9E3779B97F4A7C15;
+
+static uint64_t random_next() {
+	RandomState ^= RandomState << 13;
+	RandomState ^= RandomState >> 7;
+	RandomState ^= RandomState << 17;
+	return RandomState;
+}
+
+static double now() {
+	struct timespec Time;
+	clock_gettime(CLOCK_MONOTONIC, &Time);
+	return Time.tv_sec + Time.tv_nsec * 1e-9;
+}
+
+/*
+ * Writers
+ */
+
+static int output_write(void *UserData, const void *Bytes, size_t Size) {
+	output_t *Output = (output_t *)UserData;
+	if (Output->Size + Size > Output->Capacity) {
+		Output->Capacity = 2 * (Output->Size + Size);
+		Output->Bytes = realloc(Output->Bytes, Output->Capacity);
+	}
+	memcpy(Output->Bytes + Output->Size, Bytes, Size);
+	Output->Size += Size;
+	return Size;
+}
+
+#ifdef MINICBOR_WRITE_FN
+
+int MINICBOR_WRITE_FN(void *UserData, const void *Bytes, size_t Size) {
+	return output_write(UserData, Bytes, Size);
+}
+
+#define CORPUS_PARAMS output_t *Output
+#define BUFFER_WRITER_INIT(WRITER, BUFFER, SIZE, OUTPUT) minicbor_buffer_writer_init(WRITER, BUFFER, SIZE, OUTPUT)
+#define WRITE(NAME, ...) minicbor_write_ ## NAME(Output, ## __VA_ARGS__)
+
+#else
+
+#define CORPUS_PARAMS output_t *Output
+#define BUFFER_WRITER_INIT(WRITER, BUFFER, SIZE, OUTPUT) minicbor_buffer_writer_init(WRITER, BUFFER, SIZE, OUTPUT, output_write)
+#define WRITE(NAME, ...) minicbor_write_ ## NAME(Output, output_write, ## __VA_ARGS__)
+
+#endif
+
+#define CORPUS(NAME) write_ ## NAME
+#define WRITE_DATA(BYTES, SIZE) output_write(Output, BYTES, SIZE)
+
+#include "corpus.h"
+
+#undef CORPUS
+#undef CORPUS_PARAMS
+#undef WRITE
+#undef WRITE_DATA
+
+#define CORPUS(NAME) buffer_write_ ## NAME
+#define CORPUS_PARAMS minicbor_buffer_writer_t *Writer
+#define WRITE(NAME, ...) minicbor_buffer_write_ ## NAME(Writer, ## __VA_ARGS__)
+#define WRITE_DATA(BYTES, SIZE) minicbor_buffer_write_data(Writer, BYTES, SIZE)
+
+#include "corpus.h"
+
+typedef struct {
+	const char *Name;
+	size_t (*Write)(output_t *Output, const corpus_data_t *Data);
+	size_t (*BufferWrite)(minicbor_buffer_writer_t *Writer, const corpus_data_t *Data);
+} corpus_t;
+
+static const corpus_t Corpora[] = {
+	{"ints", write_ints, buffer_write_ints},
+	{"floats", write_floats, buffer_write_floats},
+	{"strings", write_strings, buffer_write_strings},
+	{"nested", write_nested, buffer_write_nested},
+	{"blobs", write_blobs, buffer_write_blobs}
+};
+
+#define CORPUS_COUNT (sizeof(Corpora) / sizeof(Corpora[0]))
+
+/*
+ * Readers, each callback counts one data item (or reads every byte of the piece)
+ */
+
+static size_t ReadItems;
+static uint64_t ReadCheck;
+
+static inline void read_piece(const void *Bytes, size_t Size) {
+	const unsigned char *Piece = (const unsigned char *)Bytes;
+	uint64_t Check = 0;
+	size_t Index = 0;
+	for (; Index + 8 <= Size; Index += 8) {
+		uint64_t Word;
+		memcpy(&Word, Piece + Index, 8);
+		Check ^= Word;
+	}
+	for (; Index < Size; ++Index) Check ^= Piece[Index];
+	ReadCheck ^= Check;
+}
+
+static void report_error(void *UserData, int Position, const char *Message) {
+	fprintf(stderr, "Error at %d: %s\n", Position, Message);
+	exit(1);
+}
+
+#ifdef MINICBOR_READ_FN_PREFIX
+
+#define READ_FN(NAME) MINICBOR_CONCAT(MINICBOR_READ_FN_PREFIX, NAME)
+
+void READ_FN(positive_fn)(void *UserData, uint64_t Number) { ++ReadItems; }
+void READ_FN(negative_fn)(void *UserData, uint64_t Number) { ++ReadItems; }
+void READ_FN(bytes_fn)(void *UserData, size_t Size) { ++ReadItems; }
+void READ_FN(bytes_piece_fn)(void *UserData, const void *Bytes, size_t Size, int Final) { read_piece(Bytes, Size); }
+void READ_FN(string_fn)(void *UserData, size_t Size) { ++ReadItems; }
+void READ_FN(string_piece_fn)(void *UserData, const void *Bytes, size_t Size, int Final) { read_piece(Bytes, Size); }
+void READ_FN(array_fn)(void *UserData, size_t Size) { ++ReadItems; }
+void READ_FN(map_fn)(void *UserData, size_t Size) { ++ReadItems; }
+void READ_FN(tag_fn)(void *UserData, uint64_t Tag) { ++ReadItems; }
+void READ_FN(simple_fn)(void *UserData, int Value) { ++ReadItems; }
+void READ_FN(float_fn)(void *UserData, double Number) { ++ReadItems; }
+void READ_FN(break_fn)(void *UserData) {}
+#ifdef MINICBOR_MAX_DEPTH
+void READ_FN(end_fn)(void *UserData) {}
+#endif
+void READ_FN(error_fn)(void *UserData, int Position, const char *Message) { report_error(UserData, Position, Message); }
+
+#else
+
+static void count_number(void *UserData, uint64_t Number) { ++ReadItems; }
+static void count_size(void *UserData, size_t Size) { ++ReadItems; }
+static void count_piece(void *UserData, const void *Bytes, size_t Size, int Final) { read_piece(Bytes, Size); }
+static void count_simple(void *UserData, int Value) { ++ReadItems; }
+static void count_float(void *UserData, double Number) { ++ReadItems; }
+static void ignore_break(void *UserData) {}
+
+static minicbor_reader_fns Callbacks = {
+	.PositiveFn = count_number,
+	.NegativeFn = count_number,
+	.BytesFn = count_size,
+	.BytesPieceFn = count_piece,
+	.StringFn = count_size,
+	.StringPieceFn = count_piece,
+	.ArrayFn = count_size,
+	.MapFn = count_size,
+	.TagFn = count_number,
+	.SimpleFn = count_simple,
+	.FloatFn = count_float,
+	.BreakFn = ignore_break,
+#ifdef MINICBOR_MAX_DEPTH
+	.EndFn = ignore_break,
+#endif
+	.ErrorFn = report_error
+};
+
+#endif
+
+static size_t run_read(const unsigned char *Bytes, size_t Size, size_t Chunk) {
+	minicbor_reader_t Reader;
+#ifndef MINICBOR_READ_FN_PREFIX
+	Reader.Callbacks = &Callbacks;
+#endif
+	Reader.UserData = NULL;
+	minicbor_reader_init(&Reader);
+	ReadItems = 0;
+	for (size_t Offset = 0; Offset < Size; Offset += Chunk) {
+		minicbor_read(&Reader, Bytes + Offset, Size - Offset < Chunk ? Size - Offset : Chunk);
+	}
+	if (minicbor_reader_end(&Reader)) exit(1);
+	return ReadItems;
+}
+
+static size_t run_next(const unsigned char *Bytes, size_t Size, size_t Chunk) {
+	minicbor_stream_t Stream;
+	minicbor_stream_init(&Stream);
+	size_t Items = 0, Offset = 0;
+	Stream.Available = 0;
+	for (;;) switch (minicbor_next(&Stream)) {
+	case MCE_WAIT:
+		if (Offset == Size) return Items;
+		Stream.Next = Bytes + Offset;
+		Stream.Available = Size - Offset < Chunk ? Size - Offset : Chunk;
+		Offset += Stream.Available;
+		break;
+	case MCE_BYTES_PIECE:
+	case MCE_STRING_PIECE:
+		read_piece(Stream.Bytes, Stream.Size);
+		break;
+	case MCE_BREAK:
+#ifdef MINICBOR_MAX_DEPTH
+	case MCE_END:
+#endif
+		break;
+	case MCE_ERROR:
+		fprintf(stderr, "Stream error\n");
+		exit(1);
+	default:
+		++Items;
+		break;
+	}
+}
+
+/*
+ * Repeats RUN in 4 rounds of at least TIME / 4 seconds each, returning the best average time of a single run.
+ */
+#define MEASURE(TIME, RUN) ({ \
+	double Best = 1e30; \
+	for (int Round = 0; Round < 4; ++Round) { \
+		double Start = now(), Elapsed; \
+		size_t Runs = 0; \
+		do { RUN; ++Runs; } while ((Elapsed = now() - Start) < (TIME) / 4); \
+		if (Elapsed / Runs < Best) Best = Elapsed / Runs; \
+	} \
+	Best; \
+})
+
+static void report(const char *Corpus, const char *Operation, size_t Chunk, size_t Size, size_t Items, double Time) {
+	char ChunkText[32];
+	if (Chunk) snprintf(ChunkText, sizeof(ChunkText), "%zu", Chunk); else strcpy(ChunkText, "all");
+	printf("%-8s %-8s %8s %10.1f MB/s %8.2f Mitems/s\n", Corpus, Operation, ChunkText, Size / Time / 1e6, Items / Time / 1e6);
+}
+
+static void generate_data(corpus_data_t *Data, size_t Count) {
+	static const char *Keys[4] = {"id", "name", "email", "city"};
+	Data->Count = Count;
+	Data->Integers = malloc(Count * sizeof(int64_t));
+	Data->Reals = malloc(Count * sizeof(double));
+	Data->Strings = malloc(Count * sizeof(corpus_string_t));
+	char *Chars = malloc(Count * 40);
+	for (size_t I = 0; I < Count; ++I) {
+		// Mostly small integers with some of every width
+		uint64_t Random = random_next();
+		switch (Random % 8) {
+		case 0: case 1: case 2: Data->Integers[I] = Random % 24; break;
+		case 3: Data->Integers[I] = Random % 256; break;
+		case 4: Data->Integers[I] = -(int64_t)(Random % 65536); break;
+		case 5: Data->Integers[I] = Random % 0x100000000; break;
+		default: Data->Integers[I] = (int64_t)Random; break;
+		}
+		Data->Reals[I] = (double)(int64_t)random_next() / 1e9;
+		size_t Length = 5 + random_next() % 35;
+		for (size_t J = 0; J < Length; ++J) Chars[40 * I + J] = 'a' + random_next() % 26;
+		Data->Strings[I].Chars = Chars + 40 * I;
+		Data->Strings[I].Length = Length;
+	}
+	for (int I = 0; I < 4; ++I) {
+		Data->Keys[I].Chars = Keys[I];
+		Data->Keys[I].Length = strlen(Keys[I]);
+	}
+	Data->Blob = malloc(64 * 64 + CORPUS_BLOB);
+	for (size_t I = 0; I < 64 * 64 + CORPUS_BLOB; ++I) Data->Blob[I] = random_next();
+}
+
+int main(int Argc, char **Argv) {
+	size_t Count = 1000000;
+	double Time = 0.4;
+	size_t Chunks[32] = {1, 16, 256, 4096, 65536, 0};
+	int ChunkCount = 6;
+	const char *Selected[CORPUS_COUNT];
+	int SelectedCount = 0;
+	for (int I = 1; I < Argc; ++I) {
+		if (!strcmp(Argv[I], "-n") && I + 1 < Argc) {
+			Count = strtoul(Argv[++I], NULL, 10);
+		} else if (!strcmp(Argv[I], "-t") && I + 1 < Argc) {
+			Time = strtod(Argv[++I], NULL);
+		} else if (!strcmp(Argv[I], "-c") && I + 1 < Argc) {
+			char *Next = Argv[++I];
+			ChunkCount = 0;
+			while (*Next && ChunkCount < 32) {
+				Chunks[ChunkCount++] = strtoul(Next, &Next, 10);
+				if (*Next == ',') ++Next;
+			}
+		} else if (Argv[I][0] != '-' && SelectedCount < (int)CORPUS_COUNT) {
+			Selected[SelectedCount++] = Argv[I];
+		} else {
+			fprintf(stderr, "Usage: %s [-n Count] [-t Seconds] [-c Chunk,Chunk,...] [Corpus ...]\n", Argv[0]);
+			return 1;
+		}
+	}
+	if (Count < 8 * CORPUS_DEPTH * 1024) Count = 8 * CORPUS_DEPTH * 1024;
+	corpus_data_t Data;
+	generate_data(&Data, Count);
+	for (size_t C = 0; C < CORPUS_COUNT; ++C) {
+		const corpus_t *Corpus = &Corpora[C];
+		if (SelectedCount) {
+			int Found = 0;
+			for (int I = 0; I < SelectedCount; ++I) if (!strcmp(Selected[I], Corpus->Name)) Found = 1;
+			if (!Found) continue;
+		}
+		output_t Output = {NULL, 0, 0};
+		size_t Items = Corpus->Write(&Output, &Data);
+		size_t Size = Output.Size;
+		double Elapsed = MEASURE(Time, (Output.Size = 0, Corpus->Write(&Output, &Data)));
+		report(Corpus->Name, "write", 0, Size, Items, Elapsed);
+		unsigned char Buffer[4096];
+		minicbor_buffer_writer_t Writer;
+		output_t Copy = {NULL, 0, 0};
+		Elapsed = MEASURE(Time, (
+			Copy.Size = 0,
+			BUFFER_WRITER_INIT(&Writer, Buffer, sizeof(Buffer), &Copy),
+			Corpus->BufferWrite(&Writer, &Data),
+			minicbor_buffer_flush(&Writer)
+		));
+		if (Copy.Size != Size || memcmp(Copy.Bytes, Output.Bytes, Size)) {
+			fprintf(stderr, "Buffered writer output differs for %s\n", Corpus->Name);
+			return 1;
+		}
+		report(Corpus->Name, "buffered", 0, Size, Items, Elapsed);
+		for (int I = 0; I < ChunkCount; ++I) {
+			size_t Chunk = Chunks[I] ? Chunks[I] : Size;
+			if (run_read(Output.Bytes, Size, Chunk) != Items || run_next(Output.Bytes, Size, Chunk) != Items) {
+				fprintf(stderr, "Item count mismatch for %s\n", Corpus->Name);
+				return 1;
+			}
+			Elapsed = MEASURE(Time, run_read(Output.Bytes, Size, Chunk));
+			report(Corpus->Name, "read", Chunks[I], Size, Items, Elapsed);
+			Elapsed = MEASURE(Time, run_next(Output.Bytes, Size, Chunk));
+			report(Corpus->Name, "next", Chunks[I], Size, Items, Elapsed);
+		}
+		free(Output.Bytes);
+		free(Copy.Bytes);
+	}
+	return 0;
+}
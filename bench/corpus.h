@@ -0,0 +1,68 @@
+/*
+ * Corpus writers, included once for each writer being measured with the following macros defined:
+ *   CORPUS(NAME) - the name of the writer function for corpus NAME
+ *   CORPUS_PARAMS - the parameters of each writer function
+ *   WRITE(NAME, ...) - calls the corresponding minicbor_write_NAME() function
+ *   WRITE_DATA(BYTES, SIZE) - writes the contents of a bytestring or string
+ * Each writer returns the number of data items written.
+ */
+
+static size_t CORPUS(ints)(CORPUS_PARAMS, const corpus_data_t *Data) {
+	WRITE(array, Data->Count);
+	for (size_t I = 0; I < Data->Count; ++I) WRITE(integer, Data->Integers[I]);
+	return Data->Count + 1;
+}
+
+static size_t CORPUS(floats)(CORPUS_PARAMS, const corpus_data_t *Data) {
+	WRITE(array, Data->Count);
+	for (size_t I = 0; I < Data->Count; ++I) WRITE(float8, Data->Reals[I]);
+	return Data->Count + 1;
+}
+
+static size_t CORPUS(strings)(CORPUS_PARAMS, const corpus_data_t *Data) {
+	size_t Records = Data->Count / 8;
+	WRITE(array, Records);
+	for (size_t I = 0; I < Records; ++I) {
+		WRITE(map, 4);
+		for (size_t J = 0; J < 4; ++J) {
+			const corpus_string_t *Key = &Data->Keys[J];
+			const corpus_string_t *Value = &Data->Strings[(4 * I + J) % Data->Count];
+			WRITE(string, Key->Length);
+			WRITE_DATA(Key->Chars, Key->Length);
+			WRITE(string, Value->Length);
+			WRITE_DATA(Value->Chars, Value->Length);
+		}
+	}
+	return 1 + Records * 9;
+}
+
+static size_t CORPUS(nested)(CORPUS_PARAMS, const corpus_data_t *Data) {
+	size_t Trees = Data->Count / (8 * CORPUS_DEPTH);
+	WRITE(array, Trees);
+	for (size_t I = 0; I < Trees; ++I) {
+		// Each level is {"id": Integer, "next": [Integer, Integer, <next level>]}, closed with indefinite breaks every other level
+		for (size_t Level = 0; Level < CORPUS_DEPTH; ++Level) {
+			if (Level % 2) WRITE(indef_map); else WRITE(map, 2);
+			WRITE(string, 2);
+			WRITE_DATA("id", 2);
+			WRITE(integer, Data->Integers[(I + Level) % Data->Count]);
+			WRITE(string, 4);
+			WRITE_DATA("next", 4);
+			WRITE(array, Level + 1 < CORPUS_DEPTH ? 3 : 2);
+			WRITE(integer, Level);
+			WRITE(integer, I);
+		}
+		for (size_t Level = CORPUS_DEPTH; Level-- > 0;) if (Level % 2) WRITE(break);
+	}
+	return 1 + Trees * CORPUS_DEPTH * 7;
+}
+
+static size_t CORPUS(blobs)(CORPUS_PARAMS, const corpus_data_t *Data) {
+	size_t Blobs = Data->Count / 4096;
+	WRITE(array, Blobs);
+	for (size_t I = 0; I < Blobs; ++I) {
+		WRITE(bytes, CORPUS_BLOB);
+		WRITE_DATA(Data->Blob + (I % 64) * 64, CORPUS_BLOB);
+	}
+	return 1 + Blobs;
+}
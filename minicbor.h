@@ -3,6 +3,8 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -56,6 +58,7 @@ typedef enum {
 	MCS_TAG,
 	MCS_SIMPLE,
 	MCS_FLOAT,
+	MCS_SKIP,
 	MCS_INVALID,
 	MCS_FINISHED
 } minicbor_state_t;
@@ -74,9 +77,38 @@ typedef enum {
 	MCE_SIMPLE,
 	MCE_FLOAT,
 	MCE_BREAK,
-	MCE_ERROR
+	MCE_ERROR,
+	MCE_END
 } minicbor_event_t;
 
+#ifdef MINICBOR_MAX_DEPTH
+
+/**
+ * An open array or map, used for nesting tracking when :c:macro:`MINICBOR_MAX_DEPTH` is defined.
+ * :code:`Remaining` counts the items (keys and values for maps) left in the container, counting down from :code:`SIZE_MAX` for indefinite containers.
+ */
+typedef struct {
+	size_t Remaining;
+	unsigned char Indef, Map;
+} minicbor_level_t;
+
+#endif
+
+#ifndef MINICBOR_SKIP_DEPTH
+#define MINICBOR_SKIP_DEPTH 16
+#endif
+
+/**
+ * State of a skip in progress.
+ * Definite arrays and maps are skipped by counting items only, :c:macro:`MINICBOR_SKIP_DEPTH` limits the nesting of indefinite arrays, maps and strings within a skipped item.
+ */
+typedef struct {
+	uint64_t Argument;
+	size_t Pending, Required, Count;
+	unsigned char Phase, Action, Depth;
+	size_t Stack[MINICBOR_SKIP_DEPTH];
+} minicbor_skip_t;
+
 typedef struct {
 	unsigned char Buffer[8];
 	const unsigned char *Next;
@@ -87,17 +119,59 @@ typedef struct {
 		double Real;
 		const unsigned char *Bytes;
 	};
-	size_t Size, Required;
-	unsigned Available;
+	size_t Size, Required, Available;
 	minicbor_state_t State;
+	minicbor_skip_t Skip;
+#ifdef MINICBOR_VALIDATE_UTF8
+	uint32_t Utf8;
+#endif
+#ifdef MINICBOR_MAX_DEPTH
+	int Depth;
+	minicbor_level_t Stack[MINICBOR_MAX_DEPTH];
+#endif
 } minicbor_stream_t;
 
 static inline void minicbor_stream_init(minicbor_stream_t *Stream) {
 	Stream->State = MCS_DEFAULT;
+#ifdef MINICBOR_MAX_DEPTH
+	Stream->Depth = 0;
+#endif
+#ifdef MINICBOR_VALIDATE_UTF8
+	Stream->Utf8 = 0;
+#endif
+}
+
+/**
+ * Returns 1 if :code:`Stream` is between top-level data items, i.e. the input can end here without truncating an item
+ * (or, when :c:macro:`MINICBOR_MAX_DEPTH` is defined, an array or map).
+ */
+static inline int MINICBOR(stream_complete)(const minicbor_stream_t *Stream) {
+#ifdef MINICBOR_MAX_DEPTH
+	if (Stream->Depth) return 0;
+#endif
+	return Stream->State == MCS_DEFAULT;
 }
 
 minicbor_event_t MINICBOR(next)(minicbor_stream_t *Stream);
 
+/**
+ * Skips :code:`Count` data items (of any depth) without returning any events, or if :code:`Count` is :code:`SIZE_MAX`, all items up to and including the next unmatched break.
+ * Pass the size of an array (or twice the size of a map) after :code:`MCE_ARRAY` (or :code:`MCE_MAP`) to skip its contents.
+ * If called inside a bytestring or string (or part way through decoding a data item), the rest of that item is skipped instead.
+ * This does not apply after :code:`MCE_BYTES` or :code:`MCE_STRING` with a :code:`Size` of :code:`0`, which are already complete, so the next :code:`Count` items are skipped.
+ * Returns 1 once the items have been skipped, 0 if more input is required or -1 if the input is invalid.
+ * After 0 is returned, the skip is continued by the next call to :c:func:`minicbor_skip_items()`, :c:func:`minicbor_skip()` or :c:func:`minicbor_next()` once more input is available.
+ */
+int MINICBOR(skip_items)(minicbor_stream_t *Stream, size_t Count);
+
+/**
+ * Skips the rest of the current bytestring or string (or partially decoded data item) if any, otherwise the next data item.
+ * Equivalent to :code:`minicbor_skip_items(Stream, 1)`.
+ */
+static inline int MINICBOR(skip)(minicbor_stream_t *Stream) {
+	return MINICBOR(skip_items)(Stream, 1);
+}
+
 #ifdef MINICBOR_READDATA_TYPE
 typedef MINICBOR_READDATA_TYPE MINICBOR(readdata_t);
 #else
@@ -118,6 +192,9 @@ void MINICBOR_CONCAT(MINICBOR_READ_FN_PREFIX, tag_fn)(MINICBOR(readdata_t) UserD
 void MINICBOR_CONCAT(MINICBOR_READ_FN_PREFIX, simple_fn)(MINICBOR(readdata_t) UserData, int Value);
 void MINICBOR_CONCAT(MINICBOR_READ_FN_PREFIX, float_fn)(MINICBOR(readdata_t) UserData, double Number);
 void MINICBOR_CONCAT(MINICBOR_READ_FN_PREFIX, break_fn)(MINICBOR(readdata_t) UserData);
+#ifdef MINICBOR_MAX_DEPTH
+void MINICBOR_CONCAT(MINICBOR_READ_FN_PREFIX, end_fn)(MINICBOR(readdata_t) UserData);
+#endif
 void MINICBOR_CONCAT(MINICBOR_READ_FN_PREFIX, error_fn)(MINICBOR(readdata_t) UserData, int Position, const char *Message);
 
 #else
@@ -185,6 +262,7 @@ typedef struct {
 
 	/**
 	 * Called when a floating point number is encountered.
+	 * Half and single precision numbers are widened exactly, including the sign and payload of NaNs.
 	 */
 	void (*FloatFn)(MINICBOR(readdata_t) UserData, double Number);
 
@@ -195,6 +273,14 @@ typedef struct {
 	 */
 	void (*BreakFn)(MINICBOR(readdata_t) UserData);
 
+#ifdef MINICBOR_MAX_DEPTH
+	/**
+	 * Called when an array or map ends, after its last item (or its break for indefinite arrays and maps, in which case :code:`BreakFn()` is not called).
+	 * Only available when :c:macro:`MINICBOR_MAX_DEPTH` is defined.
+	 */
+	void (*EndFn)(MINICBOR(readdata_t) UserData);
+#endif
+
 	/**
 	 * Called when an invalid CBOR sequence is detected.
 	 * This puts the reader in an invalid state, any further calls will simply trigger another call :code:`ErrorFn()`;
@@ -223,6 +309,14 @@ typedef struct minicbor_reader_t {
 	size_t Position, Required;
 	int Width;
 	minicbor_state_t State;
+	minicbor_skip_t Skip;
+#ifdef MINICBOR_VALIDATE_UTF8
+	uint32_t Utf8;
+#endif
+#ifdef MINICBOR_MAX_DEPTH
+	int Depth;
+	minicbor_level_t Stack[MINICBOR_MAX_DEPTH];
+#endif
 } minicbor_reader_t;
 
 /**
@@ -233,6 +327,12 @@ typedef struct minicbor_reader_t {
 static inline void MINICBOR(reader_init)(minicbor_reader_t *Reader) {
 	Reader->Position = 0;
 	Reader->State = MCS_DEFAULT;
+#ifdef MINICBOR_MAX_DEPTH
+	Reader->Depth = 0;
+#endif
+#ifdef MINICBOR_VALIDATE_UTF8
+	Reader->Utf8 = 0;
+#endif
 }
 
 /**
@@ -249,10 +349,33 @@ static inline void MINICBOR(reader_finish)(minicbor_reader_t *Reader) {
 	Reader->State = MCS_FINISHED;
 }
 
+/**
+ * Skips :code:`Count` data items (of any depth) following the current callback without calling any further callbacks for them,
+ * or if :code:`Count` is :code:`SIZE_MAX`, all items up to and including the next unmatched break.
+ * Pass the size of an array (or twice the size of a map) from :code:`ArrayFn()` (or :code:`MapFn()`) to skip its contents.
+ * If called from :code:`BytesFn()`, :code:`StringFn()` or a non-final piece callback, the rest of the bytestring or string is skipped instead (nothing if it is empty).
+ * Must be called from within a reader callback, the skip continues across calls to :c:func:`minicbor_read()` as required.
+ */
+void MINICBOR(reader_skip_items)(minicbor_reader_t *Reader, size_t Count);
+
+/**
+ * Skips the rest of the current bytestring or string if any, otherwise the next data item.
+ * Equivalent to :code:`minicbor_reader_skip_items(Reader, 1)`.
+ */
+static inline void MINICBOR(reader_skip)(minicbor_reader_t *Reader) {
+	MINICBOR(reader_skip_items)(Reader, 1);
+}
+
+/**
+ * Signals the end of the input to :code:`Reader`.
+ * If the input ended inside a data item (or, when :c:macro:`MINICBOR_MAX_DEPTH` is defined, inside an array or map), calls :code:`ErrorFn()` and returns 1, otherwise returns 0.
+ */
+int MINICBOR(reader_end)(minicbor_reader_t *Reader);
+
 /**
  * Returns the number of bytes remainining to be parsed by the reader.
  */
-static inline int MINICBOR(reader_remaining)(minicbor_reader_t *Reader) {
+static inline size_t MINICBOR(reader_remaining)(minicbor_reader_t *Reader) {
 	return Reader->Required;
 }
 
@@ -348,7 +471,7 @@ int MINICBOR(write_map)(MINICBOR_WRITE_PARAMS, size_t Size);
 int MINICBOR(write_indef_map)(MINICBOR_WRITE_PARAMS);
 
 /**
- * Write a floating point number in half precision.
+ * Write a floating point number in half precision, rounding to the nearest representable value.
  */
 int MINICBOR(write_float2)(MINICBOR_WRITE_PARAMS, double Number);
 
@@ -362,6 +485,11 @@ int MINICBOR(write_float4)(MINICBOR_WRITE_PARAMS, double Number);
  */
 int MINICBOR(write_float8)(MINICBOR_WRITE_PARAMS, double Number);
 
+/**
+ * Write a floating point number in the smallest of half, single or double precision which represents it exactly (including NaN payloads), as preferred serialization requires.
+ */
+int MINICBOR(write_float)(MINICBOR_WRITE_PARAMS, double Number);
+
 /**
  * Write a simple value.
  */
@@ -377,6 +505,483 @@ int MINICBOR(write_break)(MINICBOR_WRITE_PARAMS);
  */
 int MINICBOR(write_tag)(MINICBOR_WRITE_PARAMS, uint64_t Tag);
 
+/**
+ * RFC 8746 typed array tags for big-endian elements, add :code:`MINICBOR_TYPED_LITTLE` for little-endian elements (ignored for single byte elements).
+ * Elements of :code:`MINICBOR_TYPED_FLOAT16` are passed as the :code:`uint16_t` bit patterns of half precision numbers.
+ */
+typedef enum {
+	MINICBOR_TYPED_UINT8 = 64,
+	MINICBOR_TYPED_UINT16 = 65,
+	MINICBOR_TYPED_UINT32 = 66,
+	MINICBOR_TYPED_UINT64 = 67,
+	MINICBOR_TYPED_SINT8 = 72,
+	MINICBOR_TYPED_SINT16 = 73,
+	MINICBOR_TYPED_SINT32 = 74,
+	MINICBOR_TYPED_SINT64 = 75,
+	MINICBOR_TYPED_FLOAT16 = 80,
+	MINICBOR_TYPED_FLOAT32 = 81,
+	MINICBOR_TYPED_FLOAT64 = 82,
+	MINICBOR_TYPED_LITTLE = 4
+} minicbor_typed_t;
+
+/**
+ * Write :code:`Count` native elements at :code:`Values` as a typed array: a tag followed by a definite bytestring.
+ * Elements are byte swapped in blocks when the tag's byte order differs from the host's, otherwise the elements are written directly.
+ * Returns the first negative value returned by the write function, otherwise the value returned by its last call.
+ */
+int MINICBOR(write_typed_array)(MINICBOR_WRITE_PARAMS, minicbor_typed_t Type, const void *Values, size_t Count);
+
+/**
+ * Write :code:`Count` native integers at :code:`Values` as a definite array, each with the smallest width.
+ * Items are encoded in blocks, so the write function is called once per block instead of once per item.
+ * Returns the same as :c:func:`minicbor_write_typed_array()`.
+ */
+int MINICBOR(write_array_of_int64)(MINICBOR_WRITE_PARAMS, const int64_t *Values, size_t Count);
+int MINICBOR(write_array_of_uint64)(MINICBOR_WRITE_PARAMS, const uint64_t *Values, size_t Count);
+int MINICBOR(write_array_of_int32)(MINICBOR_WRITE_PARAMS, const int32_t *Values, size_t Count);
+int MINICBOR(write_array_of_uint32)(MINICBOR_WRITE_PARAMS, const uint32_t *Values, size_t Count);
+
+/**
+ * Write :code:`Count` native floating point numbers at :code:`Values` as a definite array, each as with :c:func:`minicbor_write_float()`.
+ * Returns the same as :c:func:`minicbor_write_typed_array()`.
+ */
+int MINICBOR(write_array_of_double)(MINICBOR_WRITE_PARAMS, const double *Values, size_t Count);
+int MINICBOR(write_array_of_float)(MINICBOR_WRITE_PARAMS, const float *Values, size_t Count);
+
+/**
+ * Encode a head with major type :code:`Major` (:code:`0` to :code:`7`) and argument :code:`Number` with the smallest width into :code:`Bytes`.
+ * :code:`Bytes` must have room for at least 9 bytes, which may all be overwritten.
+ * Returns the number of bytes used.
+ */
+static inline size_t MINICBOR(encode_head)(unsigned char *Bytes, unsigned char Major, uint64_t Number) {
+	if (Number < 24) {
+		Bytes[0] = (Major << 5) + Number;
+		return 1;
+	}
+	// Wider arguments take 1, 2, 4 or 8 bytes, selected without branches and stored as a full big-endian word
+	unsigned Class = (Number > 0xFF) + (Number > 0xFFFF) + (Number > 0xFFFFFFFF);
+	unsigned Width = 1 << Class;
+	uint64_t Word = __builtin_bswap64(Number << (64 - 8 * Width));
+	Bytes[0] = (Major << 5) + 0x18 + Class;
+	memcpy(Bytes + 1, &Word, 8);
+	return 1 + Width;
+}
+
+/**
+ * Decode the head at :code:`Bytes` (with :code:`Size` bytes available) into its argument :code:`Number`, the bits of floating point numbers or :code:`UINT64_MAX` for indefinite lengths and breaks.
+ * The major type is :code:`Bytes[0] >> 5`.
+ * Returns the number of bytes used, or :code:`0` if the head is truncated or not well-formed.
+ */
+static inline size_t MINICBOR(decode_head)(const unsigned char *Bytes, size_t Size, uint64_t *Number) {
+	if (!Size) return 0;
+	unsigned char Info = Bytes[0] & 0x1F;
+	if (Info < 24) {
+		*Number = Info;
+		return 1;
+	}
+	switch (Info) {
+	case 0x18:
+		if (Size < 2) return 0;
+		*Number = Bytes[1];
+		return 2;
+	case 0x19: {
+		uint16_t Word;
+		if (Size < 3) return 0;
+		memcpy(&Word, Bytes + 1, 2);
+		*Number = __builtin_bswap16(Word);
+		return 3;
+	}
+	case 0x1A: {
+		uint32_t Word;
+		if (Size < 5) return 0;
+		memcpy(&Word, Bytes + 1, 4);
+		*Number = __builtin_bswap32(Word);
+		return 5;
+	}
+	case 0x1B: {
+		uint64_t Word;
+		if (Size < 9) return 0;
+		memcpy(&Word, Bytes + 1, 8);
+		*Number = __builtin_bswap64(Word);
+		return 9;
+	}
+	case 0x1F:
+		// Only bytestrings, strings, arrays, maps and breaks have no argument
+		if ((0x43 >> (Bytes[0] >> 5)) & 1) return 0;
+		*Number = UINT64_MAX;
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Encode a simple value into :code:`Bytes` (which must have room for at least 2 bytes).
+ * Returns the number of bytes used.
+ */
+static inline size_t MINICBOR(encode_simple)(unsigned char *Bytes, unsigned char Simple) {
+	if (Simple < 24) {
+		Bytes[0] = Simple + 0xE0;
+		return 1;
+	} else {
+		Bytes[0] = 0xF8;
+		Bytes[1] = Simple;
+		return 2;
+	}
+}
+
+/**
+ * Encode a floating point number in half precision into :code:`Bytes` (which must have room for at least 3 bytes).
+ * Numbers are rounded to the nearest half precision value (ties to even), overflowing to infinity, and NaNs keep their sign and the top bits of their payload.
+ * Returns the number of bytes used.
+ */
+size_t MINICBOR(encode_float2)(unsigned char *Bytes, double Number);
+
+/**
+ * Encode a floating point number with the smallest width which represents it exactly into :code:`Bytes` (which must have room for at least 9 bytes).
+ * Returns the number of bytes used.
+ */
+size_t MINICBOR(encode_float)(unsigned char *Bytes, double Number);
+
+/**
+ * Encode a floating point number in single precision into :code:`Bytes` (which must have room for at least 5 bytes).
+ * Returns the number of bytes used.
+ */
+static inline size_t MINICBOR(encode_float4)(unsigned char *Bytes, double Number) {
+	float Single = Number;
+	uint32_t Word;
+	memcpy(&Word, &Single, 4);
+	Word = __builtin_bswap32(Word);
+	Bytes[0] = 0xFA;
+	memcpy(Bytes + 1, &Word, 4);
+	return 5;
+}
+
+/**
+ * Encode a floating point number in double precision into :code:`Bytes` (which must have room for at least 9 bytes).
+ * Returns the number of bytes used.
+ */
+static inline size_t MINICBOR(encode_float8)(unsigned char *Bytes, double Number) {
+	uint64_t Word;
+	memcpy(&Word, &Number, 8);
+	Word = __builtin_bswap64(Word);
+	Bytes[0] = 0xFB;
+	memcpy(Bytes + 1, &Word, 8);
+	return 9;
+}
+
+/**
+ * Returns the number of bytes :c:func:`minicbor_encode_head()` uses for the argument :code:`Number`, without branching.
+ * The :code:`minicbor_size_*()` functions return the exact size of the corresponding :code:`minicbor_write_*()` call, so that a message can be sized before allocating its buffer.
+ */
+static inline size_t MINICBOR(size_head)(uint64_t Number) {
+	return 1 + (Number > 23) + (Number > 0xFF) + 2 * (Number > 0xFFFF) + 4 * (Number > 0xFFFFFFFF);
+}
+
+static inline size_t MINICBOR(size_integer)(int64_t Number) {
+	return MINICBOR(size_head)(Number ^ (Number >> 63));
+}
+
+static inline size_t MINICBOR(size_positive)(uint64_t Number) {
+	return MINICBOR(size_head)(Number);
+}
+
+static inline size_t MINICBOR(size_negative)(uint64_t Number) {
+	return MINICBOR(size_head)(Number);
+}
+
+/**
+ * Returns the size of a definite bytestring or string of :code:`Size` bytes, including its contents.
+ */
+static inline size_t MINICBOR(size_bytes)(size_t Size) {
+	return MINICBOR(size_head)(Size) + Size;
+}
+
+static inline size_t MINICBOR(size_string)(size_t Size) {
+	return MINICBOR(size_head)(Size) + Size;
+}
+
+/**
+ * Returns the size of an array or map head with :code:`Size` items or pairs (the items themselves must be sized separately).
+ */
+static inline size_t MINICBOR(size_array)(size_t Size) {
+	return MINICBOR(size_head)(Size);
+}
+
+static inline size_t MINICBOR(size_map)(size_t Size) {
+	return MINICBOR(size_head)(Size);
+}
+
+static inline size_t MINICBOR(size_tag)(uint64_t Tag) {
+	return MINICBOR(size_head)(Tag);
+}
+
+static inline size_t MINICBOR(size_simple)(unsigned char Simple) {
+	return 1 + (Simple >= 24);
+}
+
+/**
+ * Returns the size of a floating point number written with :c:func:`minicbor_write_float()` (:code:`3`, :code:`5` or :code:`9`).
+ * Numbers written with :c:func:`minicbor_write_float2()`, :c:func:`minicbor_write_float4()` and :c:func:`minicbor_write_float8()` always take :code:`3`, :code:`5` and :code:`9` bytes, and indefinite heads and breaks take :code:`1` byte.
+ */
+size_t MINICBOR(size_float)(double Number);
+
+/**
+ * Returns the size of a typed array written with :c:func:`minicbor_write_typed_array()`, including its tag.
+ */
+size_t MINICBOR(size_typed_array)(minicbor_typed_t Type, size_t Count);
+
+/**
+ * Return the sizes of arrays written with the corresponding :code:`minicbor_write_array_of_*()` functions, including their heads, in a single pass over :code:`Values`.
+ */
+size_t MINICBOR(size_array_of_int64)(const int64_t *Values, size_t Count);
+size_t MINICBOR(size_array_of_uint64)(const uint64_t *Values, size_t Count);
+size_t MINICBOR(size_array_of_int32)(const int32_t *Values, size_t Count);
+size_t MINICBOR(size_array_of_uint32)(const uint32_t *Values, size_t Count);
+size_t MINICBOR(size_array_of_double)(const double *Values, size_t Count);
+size_t MINICBOR(size_array_of_float)(const float *Values, size_t Count);
+
+/**
+ * Minicbor vectored write callback type, used by :c:type:`minicbor_buffer_writer_t` to write buffered heads and large payloads together.
+ *
+ * :param UserData: Pointer passed to :c:func:`minicbor_buffer_writer_init()`.
+ * :param Vector: Regions to write, in order.
+ * :param Count: Number of regions.
+ */
+typedef int (*minicbor_writev_fn)(MINICBOR(writedata_t) UserData, const struct iovec *Vector, int Count);
+
+/**
+ * A buffered writer.
+ * Encoded heads are appended to a caller supplied buffer which is only passed to the write function when it fills up or is explicitly flushed.
+ * Must be initialized with :c:func:`minicbor_buffer_writer_init()` before use.
+ */
+typedef struct {
+	unsigned char *Start, *Next, *Limit;
+
+	/**
+	 * Passed as the first argument to the write functions.
+	 */
+	MINICBOR(writedata_t) UserData;
+
+#ifndef MINICBOR_WRITE_FN
+	minicbor_write_fn WriteFn;
+#endif
+
+	/**
+	 * Optional vectored write function, used when a payload too large to buffer is written with :c:func:`minicbor_buffer_write_data()`.
+	 * If :code:`NULL`, the buffered bytes and the payload are written with two separate calls instead.
+	 * In gather mode, this is called with the gathered regions when the buffer or vector fills up.
+	 */
+	minicbor_writev_fn WritevFn;
+
+	unsigned char *Segment;
+	struct iovec *Vector;
+	size_t Threshold;
+	int Count, Capacity;
+} minicbor_buffer_writer_t;
+
+/**
+ * Initializes :code:`Writer` to buffer into :code:`Size` bytes at :code:`Buffer` (at least 16 bytes).
+ */
+static inline void MINICBOR(buffer_writer_init)(minicbor_buffer_writer_t *Writer, void *Buffer, size_t Size, MINICBOR_WRITE_PARAMS) {
+	Writer->Start = Writer->Next = (unsigned char *)Buffer;
+	Writer->Limit = Writer->Start + Size;
+	Writer->UserData = UserData;
+#ifndef MINICBOR_WRITE_FN
+	Writer->WriteFn = WriteFn;
+#endif
+	Writer->WritevFn = NULL;
+	Writer->Segment = Writer->Start;
+	Writer->Vector = NULL;
+	Writer->Threshold = SIZE_MAX;
+	Writer->Count = Writer->Capacity = 0;
+}
+
+/**
+ * Switches :code:`Writer` to gather mode.
+ * Instead of being copied or written, payloads of at least :code:`Threshold` bytes written with :c:func:`minicbor_buffer_write_data()` are recorded by reference in :code:`Vector` (which must have room for at least 3 entries),
+ * interleaved with the regions of the buffer holding the encoded heads and smaller payloads.
+ * The gathered regions can be passed to :c:func:`writev()` or :c:func:`sendmsg()` after calling :c:func:`minicbor_buffer_gathered()`,
+ * or are passed to :c:member:`WritevFn` (if set) whenever the buffer or vector fills up.
+ * Without a :c:member:`WritevFn`, the :code:`minicbor_buffer_write_*()` functions return :code:`-1` once the buffer or vector is full.
+ * Payloads recorded by reference must remain valid until they have been written.
+ */
+static inline void MINICBOR(buffer_writer_gather)(minicbor_buffer_writer_t *Writer, struct iovec *Vector, int Capacity, size_t Threshold) {
+	Writer->Vector = Vector;
+	Writer->Capacity = Capacity;
+	Writer->Threshold = Threshold;
+}
+
+/**
+ * Returns the regions gathered by :code:`Writer` in gather mode, storing their number in :code:`Count`.
+ */
+struct iovec *MINICBOR(buffer_gathered)(minicbor_buffer_writer_t *Writer, int *Count);
+
+/**
+ * Discards any buffered bytes and gathered regions so that :code:`Writer` can be reused.
+ */
+static inline void MINICBOR(buffer_reset)(minicbor_buffer_writer_t *Writer) {
+	Writer->Next = Writer->Segment = Writer->Start;
+	Writer->Count = 0;
+}
+
+/**
+ * Writes any buffered bytes (or gathered regions in gather mode).
+ * Returns the value returned by the write function (or :code:`0` if nothing was buffered).
+ * In gather mode without a :c:member:`WritevFn`, returns :code:`-1`.
+ */
+int MINICBOR(buffer_flush)(minicbor_buffer_writer_t *Writer);
+
+/**
+ * Writes :code:`Size` payload bytes (the contents of a bytestring or string).
+ * Small payloads are copied into the buffer, larger payloads are written directly together with the buffered bytes.
+ * In gather mode, only payloads of at least :c:member:`Threshold` bytes are recorded by reference, smaller payloads are copied into the buffer after flushing if necessary.
+ */
+int MINICBOR(buffer_write_large)(minicbor_buffer_writer_t *Writer, const void *Bytes, size_t Size);
+
+/**
+ * Makes sure at least 9 bytes are free in the buffer, flushing if necessary.
+ * Returns :code:`0`, or the negative value returned by the write function if flushing fails.
+ */
+static inline int MINICBOR(buffer_reserve)(minicbor_buffer_writer_t *Writer) {
+	if (__builtin_expect(Writer->Limit - Writer->Next >= 9, 1)) return 0;
+	int Status = MINICBOR(buffer_flush)(Writer);
+	return Status < 0 ? Status : 0;
+}
+
+static inline int MINICBOR(buffer_write_head)(minicbor_buffer_writer_t *Writer, unsigned char Major, uint64_t Number) {
+	int Status = MINICBOR(buffer_reserve)(Writer);
+	if (Status) return Status;
+	Writer->Next += MINICBOR(encode_head)(Writer->Next, Major, Number);
+	return 0;
+}
+
+static inline int MINICBOR(buffer_write_byte)(minicbor_buffer_writer_t *Writer, unsigned char Byte) {
+	int Status = MINICBOR(buffer_reserve)(Writer);
+	if (Status) return Status;
+	*Writer->Next++ = Byte;
+	return 0;
+}
+
+/**
+ * Buffered equivalent of :c:func:`minicbor_write_integer()`.
+ * This and the other :code:`minicbor_buffer_write_*()` functions return :code:`0`, or the negative value returned by the write function if flushing fails.
+ */
+static inline int MINICBOR(buffer_write_integer)(minicbor_buffer_writer_t *Writer, int64_t Number) {
+	if (Number < 0) {
+		return MINICBOR(buffer_write_head)(Writer, 1, ~Number);
+	} else {
+		return MINICBOR(buffer_write_head)(Writer, 0, Number);
+	}
+}
+
+static inline int MINICBOR(buffer_write_positive)(minicbor_buffer_writer_t *Writer, uint64_t Number) {
+	return MINICBOR(buffer_write_head)(Writer, 0, Number);
+}
+
+static inline int MINICBOR(buffer_write_negative)(minicbor_buffer_writer_t *Writer, uint64_t Number) {
+	return MINICBOR(buffer_write_head)(Writer, 1, Number);
+}
+
+static inline int MINICBOR(buffer_write_bytes)(minicbor_buffer_writer_t *Writer, size_t Size) {
+	return MINICBOR(buffer_write_head)(Writer, 2, Size);
+}
+
+static inline int MINICBOR(buffer_write_indef_bytes)(minicbor_buffer_writer_t *Writer) {
+	return MINICBOR(buffer_write_byte)(Writer, 0x5F);
+}
+
+static inline int MINICBOR(buffer_write_string)(minicbor_buffer_writer_t *Writer, size_t Size) {
+	return MINICBOR(buffer_write_head)(Writer, 3, Size);
+}
+
+static inline int MINICBOR(buffer_write_indef_string)(minicbor_buffer_writer_t *Writer) {
+	return MINICBOR(buffer_write_byte)(Writer, 0x7F);
+}
+
+static inline int MINICBOR(buffer_write_array)(minicbor_buffer_writer_t *Writer, size_t Size) {
+	return MINICBOR(buffer_write_head)(Writer, 4, Size);
+}
+
+static inline int MINICBOR(buffer_write_indef_array)(minicbor_buffer_writer_t *Writer) {
+	return MINICBOR(buffer_write_byte)(Writer, 0x9F);
+}
+
+static inline int MINICBOR(buffer_write_map)(minicbor_buffer_writer_t *Writer, size_t Size) {
+	return MINICBOR(buffer_write_head)(Writer, 5, Size);
+}
+
+static inline int MINICBOR(buffer_write_indef_map)(minicbor_buffer_writer_t *Writer) {
+	return MINICBOR(buffer_write_byte)(Writer, 0xBF);
+}
+
+static inline int MINICBOR(buffer_write_tag)(minicbor_buffer_writer_t *Writer, uint64_t Tag) {
+	return MINICBOR(buffer_write_head)(Writer, 6, Tag);
+}
+
+static inline int MINICBOR(buffer_write_simple)(minicbor_buffer_writer_t *Writer, unsigned char Simple) {
+	int Status = MINICBOR(buffer_reserve)(Writer);
+	if (Status) return Status;
+	Writer->Next += MINICBOR(encode_simple)(Writer->Next, Simple);
+	return 0;
+}
+
+static inline int MINICBOR(buffer_write_float2)(minicbor_buffer_writer_t *Writer, double Number) {
+	int Status = MINICBOR(buffer_reserve)(Writer);
+	if (Status) return Status;
+	Writer->Next += MINICBOR(encode_float2)(Writer->Next, Number);
+	return 0;
+}
+
+static inline int MINICBOR(buffer_write_float4)(minicbor_buffer_writer_t *Writer, double Number) {
+	int Status = MINICBOR(buffer_reserve)(Writer);
+	if (Status) return Status;
+	Writer->Next += MINICBOR(encode_float4)(Writer->Next, Number);
+	return 0;
+}
+
+static inline int MINICBOR(buffer_write_float8)(minicbor_buffer_writer_t *Writer, double Number) {
+	int Status = MINICBOR(buffer_reserve)(Writer);
+	if (Status) return Status;
+	Writer->Next += MINICBOR(encode_float8)(Writer->Next, Number);
+	return 0;
+}
+
+static inline int MINICBOR(buffer_write_float)(minicbor_buffer_writer_t *Writer, double Number) {
+	int Status = MINICBOR(buffer_reserve)(Writer);
+	if (Status) return Status;
+	Writer->Next += MINICBOR(encode_float)(Writer->Next, Number);
+	return 0;
+}
+
+static inline int MINICBOR(buffer_write_break)(minicbor_buffer_writer_t *Writer) {
+	return MINICBOR(buffer_write_byte)(Writer, 0xFF);
+}
+
+/**
+ * Write the contents of a bytestring or string (after :c:func:`minicbor_buffer_write_bytes()` or :c:func:`minicbor_buffer_write_string()`).
+ */
+static inline int MINICBOR(buffer_write_data)(minicbor_buffer_writer_t *Writer, const void *Bytes, size_t Size) {
+	if (__builtin_expect(Size <= (size_t)(Writer->Limit - Writer->Next) && Size < Writer->Threshold, 1)) {
+		memcpy(Writer->Next, Bytes, Size);
+		Writer->Next += Size;
+		return 0;
+	}
+	return MINICBOR(buffer_write_large)(Writer, Bytes, Size);
+}
+
+/**
+ * Buffered equivalents of :c:func:`minicbor_write_typed_array()` and :code:`minicbor_write_array_of_*()`, which byte swap or encode directly into the buffer.
+ * Typed arrays which need no byte swapping are written as with :c:func:`minicbor_buffer_write_data()`.
+ */
+int MINICBOR(buffer_write_typed_array)(minicbor_buffer_writer_t *Writer, minicbor_typed_t Type, const void *Values, size_t Count);
+int MINICBOR(buffer_write_array_of_int64)(minicbor_buffer_writer_t *Writer, const int64_t *Values, size_t Count);
+int MINICBOR(buffer_write_array_of_uint64)(minicbor_buffer_writer_t *Writer, const uint64_t *Values, size_t Count);
+int MINICBOR(buffer_write_array_of_int32)(minicbor_buffer_writer_t *Writer, const int32_t *Values, size_t Count);
+int MINICBOR(buffer_write_array_of_uint32)(minicbor_buffer_writer_t *Writer, const uint32_t *Values, size_t Count);
+int MINICBOR(buffer_write_array_of_double)(minicbor_buffer_writer_t *Writer, const double *Values, size_t Count);
+int MINICBOR(buffer_write_array_of_float)(minicbor_buffer_writer_t *Writer, const float *Values, size_t Count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,912 @@
+#ifndef MINICBOR_HPP
+#define MINICBOR_HPP
+
+#include "minicbor.h"
+#include <array>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Header-only C++17 front end.
+ * :cpp:class:`minicbor::writer` is templated on its sink so that every write is inlined instead of going through a :c:type:`minicbor_write_fn`,
+ * :cpp:class:`minicbor::stream` is a pull reader wrapping :c:type:`minicbor_stream_t`,
+ * and structs registered with :c:macro:`MINICBOR_REFLECT` or :c:macro:`MINICBOR_REFLECT_ARRAY` are encoded and decoded by code generated at compile time.
+ * Errors are returned as status codes as in the C library, no exceptions are thrown except by allocations in the standard containers.
+ */
+
+#ifdef MINICBOR_WRITE_FN
+extern "C" int MINICBOR_WRITE_FN(MINICBOR(writedata_t) UserData, const void *Bytes, size_t Size);
+#endif
+
+namespace minicbor {
+
+/**
+ * Writes into a fixed buffer, failing with :code:`-1` once it is full.
+ */
+class buffer_sink {
+public:
+	buffer_sink(void *Buffer, size_t Size): Start((unsigned char *)Buffer), Next(Start), Limit(Start + Size) {}
+
+	int write(const void *Bytes, size_t Size) {
+		if (Size > size_t(Limit - Next)) return -1;
+		memcpy(Next, Bytes, Size);
+		Next += Size;
+		return 0;
+	}
+
+	unsigned char *reserve(size_t Size) {
+		return Size <= size_t(Limit - Next) ? Next : nullptr;
+	}
+
+	void commit(unsigned char *End) {
+		Next = End;
+	}
+
+	const unsigned char *data() const {
+		return Start;
+	}
+
+	size_t size() const {
+		return Next - Start;
+	}
+
+private:
+	unsigned char *Start, *Next, *Limit;
+};
+
+/**
+ * Appends to a :code:`std::vector<unsigned char>`.
+ */
+class vector_sink {
+public:
+	explicit vector_sink(std::vector<unsigned char> &Bytes): Bytes(Bytes) {}
+
+	int write(const void *Data, size_t Size) {
+		Bytes.insert(Bytes.end(), (const unsigned char *)Data, (const unsigned char *)Data + Size);
+		return 0;
+	}
+
+	unsigned char *reserve(size_t Size) {
+		size_t Used = Bytes.size();
+		Bytes.resize(Used + Size);
+		return Bytes.data() + Used;
+	}
+
+	void commit(unsigned char *End) {
+		Bytes.resize(End - Bytes.data());
+	}
+
+private:
+	std::vector<unsigned char> &Bytes;
+};
+
+/**
+ * Writes through a :c:type:`minicbor_buffer_writer_t`, encoding heads directly into its buffer.
+ */
+class buffer_writer_sink {
+public:
+	explicit buffer_writer_sink(minicbor_buffer_writer_t *Writer): Writer(Writer) {}
+
+	int write(const void *Bytes, size_t Size) {
+		return MINICBOR(buffer_write_data)(Writer, Bytes, Size);
+	}
+
+	unsigned char *reserve(size_t Size) {
+		// minicbor_buffer_reserve() only guarantees room for a head
+		if (Size > 9 || MINICBOR(buffer_reserve)(Writer)) return nullptr;
+		return Writer->Next;
+	}
+
+	void commit(unsigned char *End) {
+		Writer->Next = End;
+	}
+
+private:
+	minicbor_buffer_writer_t *Writer;
+};
+
+/**
+ * Writes through the C write function, one call per head or payload.
+ */
+class callback_sink {
+public:
+#ifdef MINICBOR_WRITE_FN
+	explicit callback_sink(MINICBOR(writedata_t) UserData): UserData(UserData) {}
+
+	int write(const void *Bytes, size_t Size) {
+		return MINICBOR_WRITE_FN(UserData, Bytes, Size);
+	}
+#else
+	callback_sink(MINICBOR(writedata_t) UserData, minicbor_write_fn WriteFn): UserData(UserData), WriteFn(WriteFn) {}
+
+	int write(const void *Bytes, size_t Size) {
+		return WriteFn(UserData, Bytes, Size);
+	}
+#endif
+
+private:
+	MINICBOR(writedata_t) UserData;
+#ifndef MINICBOR_WRITE_FN
+	minicbor_write_fn WriteFn;
+#endif
+};
+
+template <typename Sink, typename = void> struct has_reserve : std::false_type {};
+
+template <typename Sink> struct has_reserve<Sink, std::void_t<decltype(std::declval<Sink &>().reserve(size_t()))>> : std::true_type {};
+
+template <typename T, typename = void> struct codec;
+
+/**
+ * Writes CBOR to a sink, which must provide :code:`int write(const void *Bytes, size_t Size)` returning :code:`0` or a negative error.
+ * Sinks which also provide :code:`unsigned char *reserve(size_t Size)` (returning :code:`nullptr` if there is no room) and :code:`void commit(unsigned char *End)`
+ * have heads and floating point numbers encoded directly into them.
+ * Every function returns :code:`0`, or the negative value returned by the sink.
+ */
+template <typename Sink> class writer {
+public:
+	explicit writer(Sink &Out): Out(Out) {}
+
+	int head(unsigned char Major, uint64_t Number) {
+		return emit(9, [=](unsigned char *Bytes) {
+			return MINICBOR(encode_head)(Bytes, Major, Number);
+		});
+	}
+
+	int positive(uint64_t Number) {
+		return head(0, Number);
+	}
+
+	/**
+	 * As with :c:func:`minicbor_write_negative()`, writes the value :code:`-1 - Number`.
+	 */
+	int negative(uint64_t Number) {
+		return head(1, Number);
+	}
+
+	int integer(int64_t Number) {
+		return Number < 0 ? head(1, ~Number) : head(0, Number);
+	}
+
+	int bytes(const void *Bytes, size_t Size) {
+		if (int Status = head(2, Size)) return Status;
+		return Out.write(Bytes, Size);
+	}
+
+	int string(std::string_view String) {
+		if (int Status = head(3, String.size())) return Status;
+		return Out.write(String.data(), String.size());
+	}
+
+	int array(size_t Size) {
+		return head(4, Size);
+	}
+
+	int map(size_t Size) {
+		return head(5, Size);
+	}
+
+	int tag(uint64_t Tag) {
+		return head(6, Tag);
+	}
+
+	int indef_bytes() {
+		return byte(0x5F);
+	}
+
+	int indef_string() {
+		return byte(0x7F);
+	}
+
+	int indef_array() {
+		return byte(0x9F);
+	}
+
+	int indef_map() {
+		return byte(0xBF);
+	}
+
+	/**
+	 * Writes a break, ending an indefinite bytestring, string, array or map.
+	 */
+	int end() {
+		return byte(0xFF);
+	}
+
+	int simple(unsigned char Simple) {
+		return emit(2, [=](unsigned char *Bytes) {
+			return MINICBOR(encode_simple)(Bytes, Simple);
+		});
+	}
+
+	int boolean(bool Value) {
+		return byte(Value ? 0xF5 : 0xF4);
+	}
+
+	int null() {
+		return byte(0xF6);
+	}
+
+	/**
+	 * Writes a floating point number in the smallest width which represents it exactly, as with :c:func:`minicbor_write_float()`.
+	 */
+	int real(double Number) {
+		return emit(9, [=](unsigned char *Bytes) {
+			return MINICBOR(encode_float)(Bytes, Number);
+		});
+	}
+
+	int float2(double Number) {
+		return emit(3, [=](unsigned char *Bytes) {
+			return MINICBOR(encode_float2)(Bytes, Number);
+		});
+	}
+
+	int float4(double Number) {
+		return emit(5, [=](unsigned char *Bytes) {
+			return MINICBOR(encode_float4)(Bytes, Number);
+		});
+	}
+
+	int float8(double Number) {
+		return emit(9, [=](unsigned char *Bytes) {
+			return MINICBOR(encode_float8)(Bytes, Number);
+		});
+	}
+
+	/**
+	 * Writes already encoded bytes (e.g. a precomputed map key).
+	 */
+	int raw(const void *Bytes, size_t Size) {
+		return Out.write(Bytes, Size);
+	}
+
+	/**
+	 * Writes any value with a :cpp:class:`minicbor::codec`.
+	 */
+	template <typename T> int value(const T &Value) {
+		return codec<T>::encode(*this, Value);
+	}
+
+private:
+	Sink &Out;
+
+	int byte(unsigned char Byte) {
+		return emit(1, [=](unsigned char *Bytes) {
+			Bytes[0] = Byte;
+			return size_t(1);
+		});
+	}
+
+	template <typename Encoder> int emit(size_t Max, Encoder Encode) {
+		if constexpr (has_reserve<Sink>::value) {
+			if (unsigned char *Bytes = Out.reserve(Max)) {
+				Out.commit(Bytes + Encode(Bytes));
+				return 0;
+			}
+		}
+		unsigned char Bytes[9];
+		return Out.write(Bytes, Encode(Bytes));
+	}
+};
+
+/**
+ * A pull reader wrapping :c:type:`minicbor_stream_t`, with one event of lookahead.
+ * The typed functions return :code:`0` on success or :code:`-1` on invalid input, a type mismatch or if more input is required,
+ * so decoding values requires them to be complete in the input passed to :cpp:func:`feed()`.
+ */
+class stream {
+public:
+	stream() {
+		minicbor_stream_init(&Stream);
+		Stream.Available = 0;
+	}
+
+	stream(const void *Bytes, size_t Size): stream() {
+		feed(Bytes, Size);
+	}
+
+	/**
+	 * Passes the next block of input, the previous block must have been consumed.
+	 */
+	void feed(const void *Bytes, size_t Size) {
+		Stream.Next = (const unsigned char *)Bytes;
+		Stream.Available = Size;
+		if (Peeked && Event == MCE_WAIT) Peeked = false;
+	}
+
+	minicbor_event_t next() {
+		if (Peeked) {
+			Peeked = false;
+			return Event;
+		}
+		return Event = MINICBOR(next)(&Stream);
+	}
+
+	minicbor_event_t peek() {
+		if (!Peeked) {
+			Event = MINICBOR(next)(&Stream);
+			Peeked = true;
+		}
+		return Event;
+	}
+
+	/**
+	 * Accessors for the last event returned by :cpp:func:`next()` or :cpp:func:`peek()`.
+	 * :cpp:func:`integer()` is the argument of integers and tags, :cpp:func:`size()` the size of bytestrings, strings, arrays and maps (:code:`SIZE_MAX` if indefinite) or of a piece.
+	 */
+	uint64_t integer() const {
+		return Stream.Integer;
+	}
+
+	double real() const {
+		return Stream.Real;
+	}
+
+	int simple() const {
+		return Stream.Simple;
+	}
+
+	size_t size() const {
+		return Stream.Size;
+	}
+
+	const unsigned char *bytes() const {
+		return Stream.Bytes;
+	}
+
+	/**
+	 * Returns :code:`true` if the last piece was the final piece of its bytestring or string.
+	 */
+	bool final() const {
+		return !Stream.Required;
+	}
+
+	/**
+	 * Returns :code:`true` if the input can end here, see :c:func:`minicbor_stream_complete()`.
+	 */
+	bool complete() const {
+		return !Peeked && MINICBOR(stream_complete)(&Stream);
+	}
+
+	/**
+	 * Position in the current block.
+	 */
+	const unsigned char *position() const {
+		return Stream.Next;
+	}
+
+	int read(uint64_t &Value) {
+		if (next() != MCE_POSITIVE) return -1;
+		Value = Stream.Integer;
+		return 0;
+	}
+
+	int read(int64_t &Value) {
+		switch (next()) {
+		case MCE_POSITIVE:
+			if (Stream.Integer > INT64_MAX) return -1;
+			Value = Stream.Integer;
+			return 0;
+		case MCE_NEGATIVE:
+			if (Stream.Integer > INT64_MAX) return -1;
+			Value = ~(int64_t)Stream.Integer;
+			return 0;
+		default:
+			return -1;
+		}
+	}
+
+	int read(double &Value) {
+		if (next() != MCE_FLOAT) return -1;
+		Value = Stream.Real;
+		return 0;
+	}
+
+	int read(bool &Value) {
+		if (next() != MCE_SIMPLE || (Stream.Simple != CBOR_SIMPLE_FALSE && Stream.Simple != CBOR_SIMPLE_TRUE)) return -1;
+		Value = Stream.Simple == CBOR_SIMPLE_TRUE;
+		return 0;
+	}
+
+	/**
+	 * Reads a string (or a bytestring if :code:`Head` is :code:`MCE_BYTES`), pointing into the input if it is in a single piece and gathering it into :code:`Scratch` otherwise.
+	 */
+	int read(std::string_view &Value, std::string &Scratch, minicbor_event_t Head = MCE_STRING) {
+		if (next() != Head) return -1;
+		if (!Stream.Size) {
+			Value = std::string_view();
+			return 0;
+		}
+		Scratch.clear();
+		for (bool First = true;; First = false) {
+			if (next() != Head + 1) return -1;
+			std::string_view Piece((const char *)Stream.Bytes, Stream.Size);
+			if (First && !Stream.Required) {
+				Value = Piece;
+				return 0;
+			}
+			Scratch.append(Piece);
+			if (!Stream.Required) {
+				Value = Scratch;
+				return 0;
+			}
+		}
+	}
+
+	/**
+	 * Reads the head of an array or map, setting :code:`Remaining` to its size for :cpp:func:`more()`.
+	 */
+	int array(size_t &Remaining) {
+		if (next() != MCE_ARRAY) return -1;
+		Remaining = Stream.Size;
+		return 0;
+	}
+
+	int map(size_t &Remaining) {
+		if (next() != MCE_MAP) return -1;
+		Remaining = Stream.Size;
+		return 0;
+	}
+
+	/**
+	 * Returns :code:`1` if the array or map with :code:`Remaining` items (or key-value pairs) left has another, :code:`0` once it has ended or :code:`-1` on error.
+	 */
+	int more(size_t &Remaining) {
+		if (Remaining == SIZE_MAX) {
+			switch (peek()) {
+#ifdef MINICBOR_MAX_DEPTH
+			case MCE_END:
+#else
+			case MCE_BREAK:
+#endif
+				Peeked = false;
+				return 0;
+			case MCE_WAIT:
+			case MCE_ERROR:
+				return -1;
+			default:
+				return 1;
+			}
+		}
+		if (!Remaining) {
+#ifdef MINICBOR_MAX_DEPTH
+			return next() == MCE_END ? 0 : -1;
+#else
+			return 0;
+#endif
+		}
+		--Remaining;
+		return 1;
+	}
+
+	/**
+	 * Skips the next data item, however deeply nested.
+	 */
+	int skip() {
+		switch (next()) {
+		case MCE_POSITIVE:
+		case MCE_NEGATIVE:
+		case MCE_SIMPLE:
+		case MCE_FLOAT:
+			return 0;
+		case MCE_BYTES:
+		case MCE_STRING:
+			if (!Stream.Size) return 0;
+			return MINICBOR(skip)(&Stream) == 1 ? 0 : -1;
+		case MCE_ARRAY:
+			return skip_items(Stream.Size);
+		case MCE_MAP:
+			return skip_items(Stream.Size == SIZE_MAX ? SIZE_MAX : 2 * Stream.Size);
+		case MCE_TAG:
+			return skip();
+		default:
+			return -1;
+		}
+	}
+
+	/**
+	 * Reads any value with a :cpp:class:`minicbor::codec`.
+	 */
+	template <typename T> int value(T &Value) {
+		return codec<T>::decode(*this, Value);
+	}
+
+private:
+	minicbor_stream_t Stream;
+	minicbor_event_t Event = MCE_WAIT;
+	bool Peeked = false;
+
+	int skip_items(size_t Count) {
+		if (Count && MINICBOR(skip_items)(&Stream, Count) != 1) return -1;
+#ifdef MINICBOR_MAX_DEPTH
+		if (next() != MCE_END) return -1;
+#endif
+		return 0;
+	}
+};
+
+constexpr size_t head_size(uint64_t Number) {
+	return Number < 24 ? 1 : Number < 0x100 ? 2 : Number < 0x10000 ? 3 : Number < 0x100000000 ? 5 : 9;
+}
+
+/**
+ * A reflected field, with its text key encoded at compile time.
+ */
+template <typename Class, typename Member, size_t Length> struct field {
+	Member Class::*Pointer;
+	std::array<unsigned char, head_size(Length) + Length> Key;
+
+	constexpr std::string_view name() const {
+		return std::string_view((const char *)Key.data() + head_size(Length), Length);
+	}
+};
+
+template <typename Class, typename Member, size_t N> constexpr field<Class, Member, N - 1> make_field(const char (&Name)[N], Member Class::*Pointer) {
+	static_assert(N - 1 < 0x10000, "Field name too long");
+	field<Class, Member, N - 1> Field{Pointer, {}};
+	size_t Head = head_size(N - 1);
+	if (Head == 1) {
+		Field.Key[0] = 0x60 + (N - 1);
+	} else if (Head == 2) {
+		Field.Key[0] = 0x78;
+		Field.Key[1] = N - 1;
+	} else {
+		Field.Key[0] = 0x79;
+		Field.Key[1] = (N - 1) >> 8;
+		Field.Key[2] = (N - 1) & 0xFF;
+	}
+	for (size_t I = 0; I < N - 1; ++I) Field.Key[Head + I] = Name[I];
+	return Field;
+}
+
+/**
+ * Specialized by :c:macro:`MINICBOR_REFLECT` and :c:macro:`MINICBOR_REFLECT_ARRAY` with the fields of a struct.
+ */
+template <typename T> struct reflect;
+
+template <typename T, typename = void> struct is_reflected : std::false_type {};
+
+template <typename T> struct is_reflected<T, std::void_t<decltype(reflect<T>::fields())>> : std::true_type {};
+
+template <typename T> struct is_optional : std::false_type {};
+
+template <typename T> struct is_optional<std::optional<T>> : std::true_type {};
+
+template <typename T> struct codec<T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>> {
+	template <typename Writer> static int encode(Writer &Out, T Value) {
+		if constexpr (std::is_signed_v<T>) {
+			return Out.integer(Value);
+		} else {
+			return Out.positive(Value);
+		}
+	}
+
+	static int decode(stream &In, T &Value) {
+		if constexpr (std::is_signed_v<T>) {
+			int64_t Number;
+			if (In.read(Number) || Number < std::numeric_limits<T>::min() || Number > std::numeric_limits<T>::max()) return -1;
+			Value = Number;
+		} else {
+			uint64_t Number;
+			if (In.read(Number) || Number > std::numeric_limits<T>::max()) return -1;
+			Value = Number;
+		}
+		return 0;
+	}
+};
+
+template <> struct codec<bool> {
+	template <typename Writer> static int encode(Writer &Out, bool Value) {
+		return Out.boolean(Value);
+	}
+
+	static int decode(stream &In, bool &Value) {
+		return In.read(Value);
+	}
+};
+
+template <typename T> struct codec<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+	template <typename Writer> static int encode(Writer &Out, T Value) {
+		return Out.real(Value);
+	}
+
+	static int decode(stream &In, T &Value) {
+		double Number;
+		if (In.read(Number)) return -1;
+		Value = Number;
+		return 0;
+	}
+};
+
+template <> struct codec<std::string> {
+	template <typename Writer> static int encode(Writer &Out, const std::string &Value) {
+		return Out.string(Value);
+	}
+
+	static int decode(stream &In, std::string &Value) {
+		std::string_view View;
+		if (In.read(View, Value)) return -1;
+		if (View.data() != Value.data()) Value.assign(View);
+		return 0;
+	}
+};
+
+/**
+ * Decoded string views point into the input, so strings split into several pieces are rejected.
+ */
+template <> struct codec<std::string_view> {
+	template <typename Writer> static int encode(Writer &Out, std::string_view Value) {
+		return Out.string(Value);
+	}
+
+	static int decode(stream &In, std::string_view &Value) {
+		std::string Scratch;
+		if (In.read(Value, Scratch)) return -1;
+		return Value.size() && Value.data() == Scratch.data() ? -1 : 0;
+	}
+};
+
+/**
+ * :code:`std::vector<unsigned char>` is a bytestring, other vectors are arrays.
+ */
+template <> struct codec<std::vector<unsigned char>> {
+	template <typename Writer> static int encode(Writer &Out, const std::vector<unsigned char> &Value) {
+		return Out.bytes(Value.data(), Value.size());
+	}
+
+	static int decode(stream &In, std::vector<unsigned char> &Value) {
+		std::string_view View;
+		std::string Scratch;
+		if (In.read(View, Scratch, MCE_BYTES)) return -1;
+		Value.assign(View.begin(), View.end());
+		return 0;
+	}
+};
+
+template <typename T> struct codec<std::vector<T>, std::enable_if_t<!std::is_same_v<T, unsigned char>>> {
+	template <typename Writer> static int encode(Writer &Out, const std::vector<T> &Value) {
+		if (int Status = Out.array(Value.size())) return Status;
+		for (const T &Item : Value) {
+			if (int Status = codec<T>::encode(Out, Item)) return Status;
+		}
+		return 0;
+	}
+
+	static int decode(stream &In, std::vector<T> &Value) {
+		size_t Remaining;
+		if (In.array(Remaining)) return -1;
+		Value.clear();
+		for (;;) {
+			int More = In.more(Remaining);
+			if (More <= 0) return More;
+			if (int Status = codec<T>::decode(In, Value.emplace_back())) return Status;
+		}
+	}
+};
+
+template <typename T, size_t N> struct codec<std::array<T, N>> {
+	template <typename Writer> static int encode(Writer &Out, const std::array<T, N> &Value) {
+		if (int Status = Out.array(N)) return Status;
+		for (const T &Item : Value) {
+			if (int Status = codec<T>::encode(Out, Item)) return Status;
+		}
+		return 0;
+	}
+
+	static int decode(stream &In, std::array<T, N> &Value) {
+		size_t Remaining;
+		if (In.array(Remaining) || (Remaining != N && Remaining != SIZE_MAX)) return -1;
+		for (T &Item : Value) {
+			if (In.more(Remaining) != 1) return -1;
+			if (int Status = codec<T>::decode(In, Item)) return Status;
+		}
+		return In.more(Remaining) ? -1 : 0;
+	}
+};
+
+/**
+ * Empty optionals are written as null, except as fields of reflected structs where they are omitted.
+ */
+template <typename T> struct codec<std::optional<T>> {
+	template <typename Writer> static int encode(Writer &Out, const std::optional<T> &Value) {
+		return Value ? codec<T>::encode(Out, *Value) : Out.null();
+	}
+
+	static int decode(stream &In, std::optional<T> &Value) {
+		if (In.peek() == MCE_SIMPLE && In.simple() == CBOR_SIMPLE_NULL) {
+			In.next();
+			Value.reset();
+			return 0;
+		}
+		return codec<T>::decode(In, Value.emplace());
+	}
+};
+
+template <typename T> struct codec<T, std::enable_if_t<is_reflected<T>::value>> {
+	static constexpr auto Fields = reflect<T>::fields();
+	static constexpr size_t Count = std::tuple_size_v<decltype(Fields)>;
+
+	template <typename Writer> static int encode(Writer &Out, const T &Value) {
+		return encode(Out, Value, std::make_index_sequence<Count>());
+	}
+
+	static int decode(stream &In, T &Value) {
+		return decode(In, Value, std::make_index_sequence<Count>());
+	}
+
+private:
+	static_assert(Count <= 64, "Too many fields");
+
+	template <size_t I> using member_t = std::remove_reference_t<decltype(std::declval<T &>().*(std::get<I>(Fields).Pointer))>;
+
+	template <size_t... I> static constexpr uint64_t required(std::index_sequence<I...>) {
+		return (uint64_t(0) | ... | (is_optional<member_t<I>>::value ? 0 : uint64_t(1) << I));
+	}
+
+	template <typename Member> static bool present(const Member &Value) {
+		if constexpr (is_optional<Member>::value) {
+			return Value.has_value();
+		} else {
+			return true;
+		}
+	}
+
+	template <typename Writer, size_t I> static int encode_field(Writer &Out, const T &Value) {
+		constexpr auto Field = std::get<I>(Fields);
+		const auto &Member = Value.*(Field.Pointer);
+		if constexpr (reflect<T>::array) {
+			return codec<member_t<I>>::encode(Out, Member);
+		} else if constexpr (is_optional<member_t<I>>::value) {
+			if (!Member) return 0;
+			if (int Status = Out.raw(Field.Key.data(), Field.Key.size())) return Status;
+			return codec<typename member_t<I>::value_type>::encode(Out, *Member);
+		} else {
+			if (int Status = Out.raw(Field.Key.data(), Field.Key.size())) return Status;
+			return codec<member_t<I>>::encode(Out, Member);
+		}
+	}
+
+	template <typename Writer, size_t... I> static int encode(Writer &Out, const T &Value, std::index_sequence<I...>) {
+		int Status;
+		if constexpr (reflect<T>::array) {
+			Status = Out.array(Count);
+		} else {
+			Status = Out.map((size_t(0) + ... + present(Value.*(std::get<I>(Fields).Pointer))));
+		}
+		if (Status) return Status;
+		((Status = encode_field<Writer, I>(Out, Value)) || ...);
+		return Status;
+	}
+
+	template <size_t I> static int decode_field(stream &In, T &Value) {
+		auto &Member = Value.*(std::get<I>(Fields).Pointer);
+		if constexpr (!reflect<T>::array && is_optional<member_t<I>>::value) {
+			return codec<typename member_t<I>::value_type>::decode(In, Member.emplace());
+		} else {
+			return codec<member_t<I>>::decode(In, Member);
+		}
+	}
+
+	template <size_t... I> static int decode(stream &In, T &Value, std::index_sequence<I...>) {
+		size_t Remaining;
+		int Status = 0;
+		if constexpr (reflect<T>::array) {
+			if (In.array(Remaining) || (Remaining != Count && Remaining != SIZE_MAX)) return -1;
+			((Status = In.more(Remaining) != 1 ? -1 : decode_field<I>(In, Value)) || ...);
+			if (Status) return Status;
+			return In.more(Remaining) ? -1 : 0;
+		} else {
+			if (In.map(Remaining)) return -1;
+			(reset(Value.*(std::get<I>(Fields).Pointer)), ...);
+			uint64_t Seen = 0;
+			std::string Scratch;
+			for (;;) {
+				int More = In.more(Remaining);
+				if (More < 0) return -1;
+				if (!More) break;
+				if (In.peek() != MCE_STRING) {
+					// Keys other than strings are never known
+					if (In.skip() || In.skip()) return -1;
+					continue;
+				}
+				std::string_view Key;
+				if (In.read(Key, Scratch)) return -1;
+				// Comparing the length first lets the compiler discard most fields for each key
+				bool Found = ((Key.size() == std::get<I>(Fields).name().size() && !memcmp(Key.data(), std::get<I>(Fields).name().data(), Key.size()) &&
+					(Status = decode_field<I>(In, Value), Seen |= uint64_t(1) << I, true)) || ...);
+				if (Status) return Status;
+				if (!Found && In.skip()) return -1;
+			}
+			constexpr uint64_t Required = required(std::index_sequence<I...>());
+			return (Seen & Required) == Required ? 0 : -2;
+		}
+	}
+
+	template <typename Member> static void reset(Member &Value) {
+		if constexpr (is_optional<Member>::value) Value.reset();
+	}
+};
+
+/**
+ * Encodes :code:`Value` to :code:`Out`, returning :code:`0` or the negative value returned by the sink.
+ */
+template <typename Sink, typename T> int encode(Sink &Out, const T &Value) {
+	writer<Sink> Writer(Out);
+	return codec<T>::encode(Writer, Value);
+}
+
+/**
+ * Decodes the first item in :code:`Bytes` into :code:`Value`.
+ * Returns :code:`0` on success, :code:`-1` if the input is invalid, truncated or does not match :code:`T`, or :code:`-2` if a required field of a struct is missing.
+ */
+template <typename T> int decode(T &Value, const void *Bytes, size_t Size) {
+	stream Stream(Bytes, Size);
+	return codec<T>::decode(Stream, Value);
+}
+
+}
+
+#define MINICBOR_FIELD(TYPE, NAME) ::minicbor::make_field(#NAME, &TYPE::NAME)
+
+#define MINICBOR_EACH_1(M, T, X) M(T, X)
+#define MINICBOR_EACH_2(M, T, X, ...) M(T, X), MINICBOR_EACH_1(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_3(M, T, X, ...) M(T, X), MINICBOR_EACH_2(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_4(M, T, X, ...) M(T, X), MINICBOR_EACH_3(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_5(M, T, X, ...) M(T, X), MINICBOR_EACH_4(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_6(M, T, X, ...) M(T, X), MINICBOR_EACH_5(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_7(M, T, X, ...) M(T, X), MINICBOR_EACH_6(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_8(M, T, X, ...) M(T, X), MINICBOR_EACH_7(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_9(M, T, X, ...) M(T, X), MINICBOR_EACH_8(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_10(M, T, X, ...) M(T, X), MINICBOR_EACH_9(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_11(M, T, X, ...) M(T, X), MINICBOR_EACH_10(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_12(M, T, X, ...) M(T, X), MINICBOR_EACH_11(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_13(M, T, X, ...) M(T, X), MINICBOR_EACH_12(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_14(M, T, X, ...) M(T, X), MINICBOR_EACH_13(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_15(M, T, X, ...) M(T, X), MINICBOR_EACH_14(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_16(M, T, X, ...) M(T, X), MINICBOR_EACH_15(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_17(M, T, X, ...) M(T, X), MINICBOR_EACH_16(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_18(M, T, X, ...) M(T, X), MINICBOR_EACH_17(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_19(M, T, X, ...) M(T, X), MINICBOR_EACH_18(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_20(M, T, X, ...) M(T, X), MINICBOR_EACH_19(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_21(M, T, X, ...) M(T, X), MINICBOR_EACH_20(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_22(M, T, X, ...) M(T, X), MINICBOR_EACH_21(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_23(M, T, X, ...) M(T, X), MINICBOR_EACH_22(M, T, __VA_ARGS__)
+#define MINICBOR_EACH_24(M, T, X, ...) M(T, X), MINICBOR_EACH_23(M, T, __VA_ARGS__)
+
+#define MINICBOR_COUNT2(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, N, ...) N
+#define MINICBOR_COUNT(...) MINICBOR_COUNT2(__VA_ARGS__, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1)
+
+#define MINICBOR_EACH(M, T, ...) MINICBOR_CONCAT(MINICBOR_EACH_, MINICBOR_COUNT(__VA_ARGS__))(M, T, __VA_ARGS__)
+
+/**
+ * Registers up to 24 fields of :code:`TYPE` to be encoded as a map with their names as text keys.
+ * Empty :code:`std::optional` fields are omitted, unknown keys are skipped when decoding and missing fields which are not :code:`std::optional` are reported as :code:`-2`.
+ * Must be used at global scope.
+ */
+#define MINICBOR_REFLECT(TYPE, ...) \
+	template <> struct minicbor::reflect<TYPE> { \
+		static constexpr bool array = false; \
+		static constexpr auto fields() { \
+			return std::make_tuple(MINICBOR_EACH(MINICBOR_FIELD, TYPE, __VA_ARGS__)); \
+		} \
+	};
+
+/**
+ * Registers up to 24 fields of :code:`TYPE` to be encoded in order as an array.
+ */
+#define MINICBOR_REFLECT_ARRAY(TYPE, ...) \
+	template <> struct minicbor::reflect<TYPE> { \
+		static constexpr bool array = true; \
+		static constexpr auto fields() { \
+			return std::make_tuple(MINICBOR_EACH(MINICBOR_FIELD, TYPE, __VA_ARGS__)); \
+		} \
+	};
+
+#endif
@@ -0,0 +1,228 @@
+#include "minicbor_canonical.h"
+
+#ifdef MINICBOR_WRITE_FN
+
+extern int MINICBOR_WRITE_FN(MINICBOR(writedata_t) UserData, const void *Bytes, size_t Size);
+
+#define CANONICAL_WRITE(CANONICAL, BYTES, SIZE) MINICBOR_WRITE_FN((CANONICAL)->UserData, BYTES, SIZE)
+
+#else
+
+#define CANONICAL_WRITE(CANONICAL, BYTES, SIZE) (CANONICAL)->WriteFn((CANONICAL)->UserData, BYTES, SIZE)
+
+#endif
+
+void MINICBOR(canonical_init)(minicbor_canonical_t *Canonical, void *Arena, size_t Size, MINICBOR_WRITE_PARAMS) {
+	// Entries are stored downwards from the (aligned) end of the arena
+	uintptr_t Limit = ((uintptr_t)Arena + Size) & ~(uintptr_t)(sizeof(size_t) - 1);
+	if (Limit < (uintptr_t)Arena) Limit = (uintptr_t)Arena;
+	Canonical->Arena = (unsigned char *)Arena;
+	Canonical->Entries = (minicbor_canonical_entry_t *)Limit;
+	Canonical->Position = 0;
+	Canonical->UserData = UserData;
+#ifndef MINICBOR_WRITE_FN
+	Canonical->WriteFn = WriteFn;
+#endif
+	Canonical->Depth = Canonical->Maps = Canonical->Status = 0;
+}
+
+static int MINICBOR(canonical_fail)(minicbor_canonical_t *Canonical, int Status) {
+	return Canonical->Status = Status;
+}
+
+static inline size_t MINICBOR(canonical_free)(minicbor_canonical_t *Canonical) {
+	return (unsigned char *)Canonical->Entries - (Canonical->Arena + Canonical->Position);
+}
+
+/*
+ * Writes encoded bytes directly, or appends them to the arena within a map.
+ */
+static int MINICBOR(canonical_emit)(minicbor_canonical_t *Canonical, const void *Bytes, size_t Size) {
+	if (!Canonical->Maps) {
+		int Status = CANONICAL_WRITE(Canonical, Bytes, Size);
+		return Status < 0 ? MINICBOR(canonical_fail)(Canonical, Status) : 0;
+	}
+	if (Size > MINICBOR(canonical_free)(Canonical)) return MINICBOR(canonical_fail)(Canonical, -1);
+	memcpy(Canonical->Arena + Canonical->Position, Bytes, Size);
+	Canonical->Position += Size;
+	return 0;
+}
+
+/*
+ * Called before each item, records the start of a new entry if the item is a key.
+ */
+static int MINICBOR(canonical_begin)(minicbor_canonical_t *Canonical) {
+	if (Canonical->Status) return Canonical->Status;
+	if (!Canonical->Depth) return 0;
+	minicbor_canonical_frame_t *Top = Canonical->Stack + Canonical->Depth - 1;
+	if (!Top->Map || Top->Items % 2) return 0;
+	if (MINICBOR(canonical_free)(Canonical) < sizeof(minicbor_canonical_entry_t)) return MINICBOR(canonical_fail)(Canonical, -1);
+	(--Canonical->Entries)->Key = Canonical->Position;
+	return 0;
+}
+
+/*
+ * Compares the key encodings of two entries bytewise lexicographically, with shorter encodings first on a common prefix.
+ */
+static int MINICBOR(canonical_compare)(const unsigned char *Arena, const minicbor_canonical_entry_t *A, const minicbor_canonical_entry_t *B) {
+	size_t ALength = A->Value - A->Key, BLength = B->Value - B->Key;
+	int Result = memcmp(Arena + A->Key, Arena + B->Key, ALength < BLength ? ALength : BLength);
+	if (Result) return Result;
+	return (ALength > BLength) - (ALength < BLength);
+}
+
+static void MINICBOR(canonical_sift)(const unsigned char *Arena, minicbor_canonical_entry_t *Entries, size_t Root, size_t Count) {
+	minicbor_canonical_entry_t Entry = Entries[Root];
+	for (;;) {
+		size_t Child = 2 * Root + 1;
+		if (Child >= Count) break;
+		if (Child + 1 < Count && MINICBOR(canonical_compare)(Arena, Entries + Child, Entries + Child + 1) < 0) ++Child;
+		if (MINICBOR(canonical_compare)(Arena, &Entry, Entries + Child) >= 0) break;
+		Entries[Root] = Entries[Child];
+		Root = Child;
+	}
+	Entries[Root] = Entry;
+}
+
+/*
+ * Heapsorts entries by key, in place since the arena has no room to spare.
+ */
+static void MINICBOR(canonical_sort)(const unsigned char *Arena, minicbor_canonical_entry_t *Entries, size_t Count) {
+	for (size_t Root = Count / 2; Root-- > 0;) MINICBOR(canonical_sift)(Arena, Entries, Root, Count);
+	while (Count > 1) {
+		minicbor_canonical_entry_t Entry = Entries[0];
+		Entries[0] = Entries[--Count];
+		Entries[Count] = Entry;
+		MINICBOR(canonical_sift)(Arena, Entries, 0, Count);
+	}
+}
+
+/*
+ * Sorts the entries of a completed map, then writes them out (for an outermost map)
+ * or rewrites them in order in the arena using the free space as scratch.
+ */
+static int MINICBOR(canonical_close)(minicbor_canonical_t *Canonical, minicbor_canonical_frame_t *Frame) {
+	const unsigned char *Arena = Canonical->Arena;
+	minicbor_canonical_entry_t *Entries = Canonical->Entries;
+	size_t Count = Frame->Total / 2;
+	MINICBOR(canonical_sort)(Arena, Entries, Count);
+	for (size_t Index = 1; Index < Count; ++Index) {
+		if (!MINICBOR(canonical_compare)(Arena, Entries + Index - 1, Entries + Index)) return MINICBOR(canonical_fail)(Canonical, -1);
+	}
+	if (!--Canonical->Maps) {
+		for (size_t Index = 0; Index < Count; ++Index) {
+			int Status = CANONICAL_WRITE(Canonical, Arena + Entries[Index].Key, Entries[Index].End - Entries[Index].Key);
+			if (Status < 0) return MINICBOR(canonical_fail)(Canonical, Status);
+		}
+		Canonical->Position = Frame->Start;
+	} else {
+		size_t Size = Canonical->Position - Frame->Start;
+		if (Size > MINICBOR(canonical_free)(Canonical)) return MINICBOR(canonical_fail)(Canonical, -1);
+		unsigned char *Target = Canonical->Arena + Canonical->Position;
+		for (size_t Index = 0; Index < Count; ++Index) {
+			size_t Length = Entries[Index].End - Entries[Index].Key;
+			memcpy(Target, Arena + Entries[Index].Key, Length);
+			Target += Length;
+		}
+		memcpy(Canonical->Arena + Frame->Start, Canonical->Arena + Canonical->Position, Size);
+	}
+	Canonical->Entries += Count;
+	return 0;
+}
+
+/*
+ * Accounts for a completed item in its parent, closing any containers which are then complete.
+ */
+static int MINICBOR(canonical_complete)(minicbor_canonical_t *Canonical) {
+	while (Canonical->Depth) {
+		minicbor_canonical_frame_t *Top = Canonical->Stack + Canonical->Depth - 1;
+		if (Top->Map) {
+			// Nested maps have already released their entries, so the current entry is the first
+			if (Top->Items % 2) {
+				Canonical->Entries->End = Canonical->Position;
+			} else {
+				Canonical->Entries->Value = Canonical->Position;
+			}
+		}
+		if (++Top->Items < Top->Total) return 0;
+		--Canonical->Depth;
+		if (Top->Map && MINICBOR(canonical_close)(Canonical, Top)) return Canonical->Status;
+	}
+	return 0;
+}
+
+static int MINICBOR(canonical_open)(minicbor_canonical_t *Canonical, size_t Total, int Map) {
+	if (!Total) return MINICBOR(canonical_complete)(Canonical);
+	if (Canonical->Depth == MINICBOR_CANONICAL_DEPTH) return MINICBOR(canonical_fail)(Canonical, -1);
+	minicbor_canonical_frame_t *Frame = Canonical->Stack + Canonical->Depth++;
+	Frame->Total = Total;
+	Frame->Items = 0;
+	Frame->Start = Canonical->Position;
+	Frame->Map = Map;
+	if (Map) ++Canonical->Maps;
+	return 0;
+}
+
+static int MINICBOR(canonical_head)(minicbor_canonical_t *Canonical, unsigned char Major, uint64_t Number) {
+	unsigned char Bytes[9];
+	if (MINICBOR(canonical_begin)(Canonical)) return Canonical->Status;
+	return MINICBOR(canonical_emit)(Canonical, Bytes, MINICBOR(encode_head)(Bytes, Major, Number));
+}
+
+int MINICBOR(canonical_write_integer)(minicbor_canonical_t *Canonical, int64_t Number) {
+	int Status = Number < 0 ? MINICBOR(canonical_head)(Canonical, 1, ~Number) : MINICBOR(canonical_head)(Canonical, 0, Number);
+	if (Status) return Status;
+	return MINICBOR(canonical_complete)(Canonical);
+}
+
+int MINICBOR(canonical_write_positive)(minicbor_canonical_t *Canonical, uint64_t Number) {
+	if (MINICBOR(canonical_head)(Canonical, 0, Number)) return Canonical->Status;
+	return MINICBOR(canonical_complete)(Canonical);
+}
+
+int MINICBOR(canonical_write_negative)(minicbor_canonical_t *Canonical, uint64_t Number) {
+	if (MINICBOR(canonical_head)(Canonical, 1, Number)) return Canonical->Status;
+	return MINICBOR(canonical_complete)(Canonical);
+}
+
+int MINICBOR(canonical_write_bytes)(minicbor_canonical_t *Canonical, const void *Bytes, size_t Size) {
+	if (MINICBOR(canonical_head)(Canonical, 2, Size)) return Canonical->Status;
+	if (Size && MINICBOR(canonical_emit)(Canonical, Bytes, Size)) return Canonical->Status;
+	return MINICBOR(canonical_complete)(Canonical);
+}
+
+int MINICBOR(canonical_write_string)(minicbor_canonical_t *Canonical, const char *String, size_t Length) {
+	if (MINICBOR(canonical_head)(Canonical, 3, Length)) return Canonical->Status;
+	if (Length && MINICBOR(canonical_emit)(Canonical, String, Length)) return Canonical->Status;
+	return MINICBOR(canonical_complete)(Canonical);
+}
+
+int MINICBOR(canonical_write_array)(minicbor_canonical_t *Canonical, size_t Size) {
+	if (MINICBOR(canonical_head)(Canonical, 4, Size)) return Canonical->Status;
+	return MINICBOR(canonical_open)(Canonical, Size, 0);
+}
+
+int MINICBOR(canonical_write_map)(minicbor_canonical_t *Canonical, size_t Size) {
+	if (Size > SIZE_MAX / 2) return MINICBOR(canonical_fail)(Canonical, -1);
+	if (MINICBOR(canonical_head)(Canonical, 5, Size)) return Canonical->Status;
+	return MINICBOR(canonical_open)(Canonical, 2 * Size, 1);
+}
+
+int MINICBOR(canonical_write_tag)(minicbor_canonical_t *Canonical, uint64_t Tag) {
+	if (MINICBOR(canonical_head)(Canonical, 6, Tag)) return Canonical->Status;
+	return MINICBOR(canonical_open)(Canonical, 1, 0);
+}
+
+int MINICBOR(canonical_write_simple)(minicbor_canonical_t *Canonical, unsigned char Simple) {
+	unsigned char Bytes[2];
+	if (MINICBOR(canonical_begin)(Canonical)) return Canonical->Status;
+	if (MINICBOR(canonical_emit)(Canonical, Bytes, MINICBOR(encode_simple)(Bytes, Simple))) return Canonical->Status;
+	return MINICBOR(canonical_complete)(Canonical);
+}
+
+int MINICBOR(canonical_write_float)(minicbor_canonical_t *Canonical, double Number) {
+	unsigned char Bytes[9];
+	if (MINICBOR(canonical_begin)(Canonical)) return Canonical->Status;
+	if (MINICBOR(canonical_emit)(Canonical, Bytes, MINICBOR(encode_float)(Bytes, Number))) return Canonical->Status;
+	return MINICBOR(canonical_complete)(Canonical);
+}
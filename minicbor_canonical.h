@@ -0,0 +1,91 @@
+#ifndef MINICBOR_CANONICAL_H
+#define MINICBOR_CANONICAL_H
+
+#include "minicbor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A canonical encoder writes deterministically encoded CBOR (RFC 8949 section 4.2) regardless of the order in which map entries are written.
+ * Heads and floating point numbers always use their shortest form, only definite lengths can be written
+ * and the key-value pairs of each map are buffered in a caller supplied arena, then sorted bytewise lexicographically by their key encodings when the map is complete.
+ * Items outside any map are written directly.
+ *
+ * The arena holds the encodings of the open maps (and everything within them) plus a record of 3 :code:`size_t` values per key.
+ * A nested map also needs as much free space as its own encoding when it is sorted.
+ */
+
+#ifndef MINICBOR_CANONICAL_DEPTH
+#define MINICBOR_CANONICAL_DEPTH 64
+#endif
+
+/**
+ * An open array, map or tag (a container of one item). Total and Items count keys and values separately for maps.
+ */
+typedef struct {
+	size_t Total, Items, Start;
+	int Map;
+} minicbor_canonical_frame_t;
+
+/**
+ * The position of a key, its value and the end of the value within the arena.
+ */
+typedef struct {
+	size_t Key, Value, End;
+} minicbor_canonical_entry_t;
+
+typedef struct {
+	unsigned char *Arena;
+	minicbor_canonical_entry_t *Entries;
+	size_t Position;
+
+	/**
+	 * Passed as the first argument to the write function.
+	 */
+	MINICBOR(writedata_t) UserData;
+
+#ifndef MINICBOR_WRITE_FN
+	minicbor_write_fn WriteFn;
+#endif
+
+	int Depth, Maps, Status;
+	minicbor_canonical_frame_t Stack[MINICBOR_CANONICAL_DEPTH];
+} minicbor_canonical_t;
+
+/**
+ * Initializes :code:`Canonical` to buffer maps into :code:`Size` bytes at :code:`Arena` and write the encoded output with the write function.
+ */
+void MINICBOR(canonical_init)(minicbor_canonical_t *Canonical, void *Arena, size_t Size, MINICBOR_WRITE_PARAMS);
+
+/**
+ * Canonical equivalents of the :code:`minicbor_write_*()` functions, which return :code:`0`, or a negative value on error.
+ * An error is either the negative value returned by the write function or :code:`-1` if the arena is full, the maximum depth is exceeded or a map has duplicate keys.
+ * Errors are sticky: once one has occurred, every later call returns it.
+ * Bytestrings and strings are written together with their contents, floating point numbers in the smallest exact width.
+ */
+int MINICBOR(canonical_write_integer)(minicbor_canonical_t *Canonical, int64_t Number);
+int MINICBOR(canonical_write_positive)(minicbor_canonical_t *Canonical, uint64_t Number);
+int MINICBOR(canonical_write_negative)(minicbor_canonical_t *Canonical, uint64_t Number);
+int MINICBOR(canonical_write_bytes)(minicbor_canonical_t *Canonical, const void *Bytes, size_t Size);
+int MINICBOR(canonical_write_string)(minicbor_canonical_t *Canonical, const char *String, size_t Length);
+int MINICBOR(canonical_write_array)(minicbor_canonical_t *Canonical, size_t Size);
+int MINICBOR(canonical_write_map)(minicbor_canonical_t *Canonical, size_t Size);
+int MINICBOR(canonical_write_tag)(minicbor_canonical_t *Canonical, uint64_t Tag);
+int MINICBOR(canonical_write_simple)(minicbor_canonical_t *Canonical, unsigned char Simple);
+int MINICBOR(canonical_write_float)(minicbor_canonical_t *Canonical, double Number);
+
+/**
+ * Returns :code:`0` if every array, map and tag written has been completed (so all output has been written), otherwise the current error or :code:`-1`.
+ */
+static inline int MINICBOR(canonical_end)(minicbor_canonical_t *Canonical) {
+	if (Canonical->Status) return Canonical->Status;
+	return Canonical->Depth ? -1 : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,418 @@
+#include "minicbor_dom.h"
+
+#ifdef MINICBOR_WRITE_FN
+
+extern int MINICBOR_WRITE_FN(MINICBOR(writedata_t) UserData, const void *Bytes, size_t Size);
+
+#define MINICBOR_WRITE_ARGS UserData
+#define DOM_WRITE(BYTES, SIZE) MINICBOR_WRITE_FN(UserData, BYTES, SIZE)
+
+#else
+
+#define MINICBOR_WRITE_ARGS UserData, WriteFn
+#define DOM_WRITE(BYTES, SIZE) WriteFn(UserData, BYTES, SIZE)
+
+#endif
+
+#define DOM_INFO(TYPE, NEXT) (((uint32_t)(TYPE) << 28) | (uint32_t)(NEXT))
+
+void MINICBOR(dom_init)(minicbor_dom_t *Dom, void *Arena, size_t Size) {
+	// Nodes are stored upwards from the (aligned) start of the arena
+	uintptr_t Start = ((uintptr_t)Arena + 7) & ~(uintptr_t)7;
+	if (Start > (uintptr_t)Arena + Size) Start = (uintptr_t)Arena + Size;
+	Dom->Nodes = (minicbor_dom_node_t *)Start;
+	Dom->End = (unsigned char *)Arena + Size;
+	MINICBOR(dom_reset)(Dom);
+}
+
+static void MINICBOR(dom_fail)(minicbor_dom_t *Dom, const char *Message) {
+	if (!Dom->Error) Dom->Error = Message;
+}
+
+/*
+ * Allocates the next node, as a leaf whose subtree ends directly after it.
+ */
+static minicbor_dom_node_t *MINICBOR(dom_node)(minicbor_dom_t *Dom, minicbor_event_t Type) {
+	if (Dom->Error) return NULL;
+	if (Dom->Pending) {
+		MINICBOR(dom_fail)(Dom, "Unexpected item in string");
+		return NULL;
+	}
+	size_t Free = Dom->Limit - (unsigned char *)(Dom->Nodes + Dom->Count);
+	if (Free < sizeof(minicbor_dom_node_t) || Dom->Count == MINICBOR_DOM_MAX_INDEX) {
+		MINICBOR(dom_fail)(Dom, "Arena full");
+		return NULL;
+	}
+	minicbor_dom_node_t *Node = Dom->Nodes + Dom->Count++;
+	Node->Size = 0;
+	Node->Info = DOM_INFO(Type, Dom->Count);
+	return Node;
+}
+
+/*
+ * Ends the array or map at the top of the stack, once all its items have been added.
+ */
+static void MINICBOR(dom_close)(minicbor_dom_t *Dom) {
+	minicbor_dom_frame_t *Top = Dom->Stack + --Dom->Depth;
+	minicbor_dom_node_t *Node = Dom->Nodes + Top->Node;
+	Node->Info |= Dom->Count;
+	if ((Node->Info >> 28) == MCE_MAP) {
+		if (Top->Items % 2) MINICBOR(dom_fail)(Dom, "Incomplete map");
+		Node->Size = Top->Items / 2;
+	} else if ((Node->Info >> 28) == MCE_ARRAY) {
+		Node->Size = Top->Items;
+	}
+}
+
+/*
+ * Accounts for a completed item in its parent, closing any definite arrays, maps or tags which are then complete.
+ */
+static void MINICBOR(dom_item)(minicbor_dom_t *Dom) {
+	while (Dom->Depth) {
+		minicbor_dom_frame_t *Top = Dom->Stack + Dom->Depth - 1;
+		if (++Top->Items != Top->Total) return;
+#ifdef MINICBOR_MAX_DEPTH
+		// The reader also reports the end of arrays and maps
+		if ((Dom->Nodes[Top->Node].Info >> 28) != MCE_TAG) ++Dom->Ends;
+#endif
+		MINICBOR(dom_close)(Dom);
+	}
+}
+
+static void MINICBOR(dom_open)(minicbor_dom_t *Dom, minicbor_event_t Type, size_t Size, size_t Total) {
+	minicbor_dom_node_t *Node = MINICBOR(dom_node)(Dom, Type);
+	if (!Node) return;
+	if (Size != SIZE_MAX && Size > MINICBOR_DOM_MAX_INDEX) {
+		MINICBOR(dom_fail)(Dom, "Arena full");
+		return;
+	}
+	if (Size != SIZE_MAX) Node->Size = Size;
+	if (!Total) {
+#ifdef MINICBOR_MAX_DEPTH
+		++Dom->Ends;
+#endif
+		MINICBOR(dom_item)(Dom);
+		return;
+	}
+	if (Dom->Depth == MINICBOR_DOM_DEPTH) {
+		MINICBOR(dom_fail)(Dom, "Maximum nesting depth exceeded");
+		return;
+	}
+	Node->Info = DOM_INFO(Type, 0);
+	minicbor_dom_frame_t *Frame = Dom->Stack + Dom->Depth++;
+	Frame->Node = Node - Dom->Nodes;
+	Frame->Items = 0;
+	Frame->Total = Total;
+}
+
+static void MINICBOR(dom_string)(minicbor_dom_t *Dom, minicbor_event_t Type, size_t Size) {
+	minicbor_dom_node_t *Node = MINICBOR(dom_node)(Dom, Type);
+	if (!Node) return;
+	Node->Bytes = NULL;
+	if (!Size) {
+		MINICBOR(dom_item)(Dom);
+		return;
+	}
+	Dom->Pending = 1;
+	Dom->Copying = 0;
+	Dom->Piece = NULL;
+	Dom->Length = 0;
+}
+
+/*
+ * Adds a piece to the current string. A string which arrives as a single piece points into the input,
+ * otherwise its pieces are gathered in the free space after the last node, then moved to the end of the arena.
+ */
+static void MINICBOR(dom_piece)(minicbor_dom_t *Dom, const unsigned char *Bytes, size_t Size, int Final) {
+	if (Dom->Error) return;
+	if (!Dom->Pending) {
+		MINICBOR(dom_fail)(Dom, "Unexpected string piece");
+		return;
+	}
+	minicbor_dom_node_t *Node = Dom->Nodes + Dom->Count - 1;
+	unsigned char *Gather = (unsigned char *)(Dom->Nodes + Dom->Count);
+	if (!Dom->Copying) {
+		if (!Dom->Length) {
+			Dom->Piece = Bytes;
+			Dom->Length = Size;
+			Size = 0;
+		} else if (Size) {
+			if (Dom->Length > (size_t)(Dom->Limit - Gather)) {
+				MINICBOR(dom_fail)(Dom, "Arena full");
+				return;
+			}
+			memcpy(Gather, Dom->Piece, Dom->Length);
+			Dom->Copying = 1;
+		}
+	}
+	if (Size) {
+		if (Size > (size_t)(Dom->Limit - Gather) - Dom->Length) {
+			MINICBOR(dom_fail)(Dom, "Arena full");
+			return;
+		}
+		memcpy(Gather + Dom->Length, Bytes, Size);
+		Dom->Length += Size;
+	}
+	if (!Final) return;
+	if (Dom->Length > UINT32_MAX) {
+		MINICBOR(dom_fail)(Dom, "String too large");
+		return;
+	}
+	if (Dom->Copying) {
+		Dom->Limit -= Dom->Length;
+		memmove(Dom->Limit, Gather, Dom->Length);
+		Node->Bytes = Dom->Limit;
+	} else {
+		Node->Bytes = Dom->Piece;
+	}
+	Node->Size = Dom->Length;
+	Dom->Pending = 0;
+	MINICBOR(dom_item)(Dom);
+}
+
+void MINICBOR(dom_positive_fn)(minicbor_dom_t *Dom, uint64_t Number) {
+	minicbor_dom_node_t *Node = MINICBOR(dom_node)(Dom, MCE_POSITIVE);
+	if (!Node) return;
+	Node->Integer = Number;
+	MINICBOR(dom_item)(Dom);
+}
+
+void MINICBOR(dom_negative_fn)(minicbor_dom_t *Dom, uint64_t Number) {
+	minicbor_dom_node_t *Node = MINICBOR(dom_node)(Dom, MCE_NEGATIVE);
+	if (!Node) return;
+	Node->Integer = Number;
+	MINICBOR(dom_item)(Dom);
+}
+
+void MINICBOR(dom_bytes_fn)(minicbor_dom_t *Dom, size_t Size) {
+	MINICBOR(dom_string)(Dom, MCE_BYTES, Size);
+}
+
+void MINICBOR(dom_bytes_piece_fn)(minicbor_dom_t *Dom, const void *Bytes, size_t Size, int Final) {
+	MINICBOR(dom_piece)(Dom, (const unsigned char *)Bytes, Size, Final);
+}
+
+void MINICBOR(dom_string_fn)(minicbor_dom_t *Dom, size_t Size) {
+	MINICBOR(dom_string)(Dom, MCE_STRING, Size);
+}
+
+void MINICBOR(dom_string_piece_fn)(minicbor_dom_t *Dom, const void *Bytes, size_t Size, int Final) {
+	MINICBOR(dom_piece)(Dom, (const unsigned char *)Bytes, Size, Final);
+}
+
+void MINICBOR(dom_array_fn)(minicbor_dom_t *Dom, size_t Size) {
+	MINICBOR(dom_open)(Dom, MCE_ARRAY, Size, Size);
+}
+
+void MINICBOR(dom_map_fn)(minicbor_dom_t *Dom, size_t Size) {
+	MINICBOR(dom_open)(Dom, MCE_MAP, Size, Size == SIZE_MAX ? SIZE_MAX : 2 * Size);
+}
+
+void MINICBOR(dom_tag_fn)(minicbor_dom_t *Dom, uint64_t Tag) {
+	MINICBOR(dom_open)(Dom, MCE_TAG, 0, 1);
+	if (!Dom->Error) Dom->Nodes[Dom->Count - 1].Integer = Tag;
+}
+
+void MINICBOR(dom_simple_fn)(minicbor_dom_t *Dom, int Value) {
+	minicbor_dom_node_t *Node = MINICBOR(dom_node)(Dom, MCE_SIMPLE);
+	if (!Node) return;
+	Node->Integer = Value;
+	MINICBOR(dom_item)(Dom);
+}
+
+void MINICBOR(dom_float_fn)(minicbor_dom_t *Dom, double Number) {
+	minicbor_dom_node_t *Node = MINICBOR(dom_node)(Dom, MCE_FLOAT);
+	if (!Node) return;
+	Node->Real = Number;
+	MINICBOR(dom_item)(Dom);
+}
+
+void MINICBOR(dom_break_fn)(minicbor_dom_t *Dom) {
+	if (Dom->Error) return;
+	if (!Dom->Depth || Dom->Stack[Dom->Depth - 1].Total != SIZE_MAX) {
+		MINICBOR(dom_fail)(Dom, "Unexpected break");
+		return;
+	}
+	MINICBOR(dom_close)(Dom);
+	MINICBOR(dom_item)(Dom);
+}
+
+#ifdef MINICBOR_MAX_DEPTH
+
+void MINICBOR(dom_end_fn)(minicbor_dom_t *Dom) {
+	// Definite arrays and maps have already been closed when their last item was added
+	if (Dom->Ends) {
+		--Dom->Ends;
+	} else {
+		MINICBOR(dom_break_fn)(Dom);
+	}
+}
+
+#endif
+
+void MINICBOR(dom_error_fn)(minicbor_dom_t *Dom, int Position, const char *Message) {
+	MINICBOR(dom_fail)(Dom, Message);
+}
+
+#if !defined(MINICBOR_READ_FN_PREFIX) && !defined(MINICBOR_READDATA_TYPE)
+
+static void MINICBOR(dom_reader_positive)(void *UserData, uint64_t Number) {
+	MINICBOR(dom_positive_fn)((minicbor_dom_t *)UserData, Number);
+}
+
+static void MINICBOR(dom_reader_negative)(void *UserData, uint64_t Number) {
+	MINICBOR(dom_negative_fn)((minicbor_dom_t *)UserData, Number);
+}
+
+static void MINICBOR(dom_reader_bytes)(void *UserData, size_t Size) {
+	MINICBOR(dom_bytes_fn)((minicbor_dom_t *)UserData, Size);
+}
+
+static void MINICBOR(dom_reader_bytes_piece)(void *UserData, const void *Bytes, size_t Size, int Final) {
+	MINICBOR(dom_bytes_piece_fn)((minicbor_dom_t *)UserData, Bytes, Size, Final);
+}
+
+static void MINICBOR(dom_reader_string)(void *UserData, size_t Size) {
+	MINICBOR(dom_string_fn)((minicbor_dom_t *)UserData, Size);
+}
+
+static void MINICBOR(dom_reader_string_piece)(void *UserData, const void *Bytes, size_t Size, int Final) {
+	MINICBOR(dom_string_piece_fn)((minicbor_dom_t *)UserData, Bytes, Size, Final);
+}
+
+static void MINICBOR(dom_reader_array)(void *UserData, size_t Size) {
+	MINICBOR(dom_array_fn)((minicbor_dom_t *)UserData, Size);
+}
+
+static void MINICBOR(dom_reader_map)(void *UserData, size_t Size) {
+	MINICBOR(dom_map_fn)((minicbor_dom_t *)UserData, Size);
+}
+
+static void MINICBOR(dom_reader_tag)(void *UserData, uint64_t Tag) {
+	MINICBOR(dom_tag_fn)((minicbor_dom_t *)UserData, Tag);
+}
+
+static void MINICBOR(dom_reader_simple)(void *UserData, int Value) {
+	MINICBOR(dom_simple_fn)((minicbor_dom_t *)UserData, Value);
+}
+
+static void MINICBOR(dom_reader_float)(void *UserData, double Number) {
+	MINICBOR(dom_float_fn)((minicbor_dom_t *)UserData, Number);
+}
+
+static void MINICBOR(dom_reader_break)(void *UserData) {
+	MINICBOR(dom_break_fn)((minicbor_dom_t *)UserData);
+}
+
+#ifdef MINICBOR_MAX_DEPTH
+
+static void MINICBOR(dom_reader_end)(void *UserData) {
+	MINICBOR(dom_end_fn)((minicbor_dom_t *)UserData);
+}
+
+#endif
+
+static void MINICBOR(dom_reader_error)(void *UserData, int Position, const char *Message) {
+	MINICBOR(dom_error_fn)((minicbor_dom_t *)UserData, Position, Message);
+}
+
+static MINICBOR(reader_fns) MinicborDomCallbacks = {
+	.PositiveFn = MINICBOR(dom_reader_positive),
+	.NegativeFn = MINICBOR(dom_reader_negative),
+	.BytesFn = MINICBOR(dom_reader_bytes),
+	.BytesPieceFn = MINICBOR(dom_reader_bytes_piece),
+	.StringFn = MINICBOR(dom_reader_string),
+	.StringPieceFn = MINICBOR(dom_reader_string_piece),
+	.ArrayFn = MINICBOR(dom_reader_array),
+	.MapFn = MINICBOR(dom_reader_map),
+	.TagFn = MINICBOR(dom_reader_tag),
+	.SimpleFn = MINICBOR(dom_reader_simple),
+	.FloatFn = MINICBOR(dom_reader_float),
+	.BreakFn = MINICBOR(dom_reader_break),
+#ifdef MINICBOR_MAX_DEPTH
+	.EndFn = MINICBOR(dom_reader_end),
+#endif
+	.ErrorFn = MINICBOR(dom_reader_error)
+};
+
+void MINICBOR(dom_reader_init)(minicbor_reader_t *Reader, minicbor_dom_t *Dom) {
+	MINICBOR(dom_reset)(Dom);
+	MINICBOR(reader_init)(Reader);
+	Reader->Callbacks = &MinicborDomCallbacks;
+	Reader->UserData = Dom;
+}
+
+int MINICBOR(dom_parse)(minicbor_dom_t *Dom, const void *Bytes, size_t Size) {
+	minicbor_reader_t Reader[1];
+	MINICBOR(dom_reader_init)(Reader, Dom);
+	MINICBOR(read)(Reader, (const unsigned char *)Bytes, Size);
+	MINICBOR(reader_end)(Reader);
+	if (!MINICBOR(dom_complete)(Dom)) {
+		MINICBOR(dom_fail)(Dom, "Unexpected end of input");
+		return -1;
+	}
+	return 0;
+}
+
+#endif
+
+size_t MINICBOR(dom_index)(const minicbor_dom_t *Dom, size_t Index, size_t Position) {
+	if (MINICBOR(dom_type)(Dom, Index) != MCE_ARRAY || Position >= Dom->Nodes[Index].Size) return SIZE_MAX;
+	size_t Item = Index + 1;
+	while (Position--) Item = MINICBOR(dom_next)(Dom, Item);
+	return Item;
+}
+
+size_t MINICBOR(dom_get)(const minicbor_dom_t *Dom, size_t Index, const char *Key, size_t Length) {
+	if (MINICBOR(dom_type)(Dom, Index) != MCE_MAP) return SIZE_MAX;
+	size_t End = MINICBOR(dom_next)(Dom, Index);
+	for (size_t Item = Index + 1; Item < End;) {
+		const minicbor_dom_node_t *Node = Dom->Nodes + Item;
+		Item = MINICBOR(dom_next)(Dom, Item);
+		if ((Node->Info >> 28) == MCE_STRING && Node->Size == Length && !memcmp(Node->Bytes, Key, Length)) return Item;
+		Item = MINICBOR(dom_next)(Dom, Item);
+	}
+	return SIZE_MAX;
+}
+
+int MINICBOR(dom_write)(const minicbor_dom_t *Dom, size_t Index, MINICBOR_WRITE_PARAMS) {
+	// Nodes are in document order, so a subtree is written by writing each of its nodes in turn
+	size_t End = MINICBOR(dom_next)(Dom, Index);
+	for (const minicbor_dom_node_t *Node = Dom->Nodes + Index; Node < Dom->Nodes + End; ++Node) {
+		int Status;
+		switch (Node->Info >> 28) {
+		case MCE_POSITIVE:
+			Status = MINICBOR(write_positive)(MINICBOR_WRITE_ARGS, Node->Integer);
+			break;
+		case MCE_NEGATIVE:
+			Status = MINICBOR(write_negative)(MINICBOR_WRITE_ARGS, Node->Integer);
+			break;
+		case MCE_BYTES:
+			Status = MINICBOR(write_bytes)(MINICBOR_WRITE_ARGS, Node->Size);
+			if (Status >= 0 && Node->Size) Status = DOM_WRITE(Node->Bytes, Node->Size);
+			break;
+		case MCE_STRING:
+			Status = MINICBOR(write_string)(MINICBOR_WRITE_ARGS, Node->Size);
+			if (Status >= 0 && Node->Size) Status = DOM_WRITE(Node->Bytes, Node->Size);
+			break;
+		case MCE_ARRAY:
+			Status = MINICBOR(write_array)(MINICBOR_WRITE_ARGS, Node->Size);
+			break;
+		case MCE_MAP:
+			Status = MINICBOR(write_map)(MINICBOR_WRITE_ARGS, Node->Size);
+			break;
+		case MCE_TAG:
+			Status = MINICBOR(write_tag)(MINICBOR_WRITE_ARGS, Node->Integer);
+			break;
+		case MCE_SIMPLE:
+			Status = MINICBOR(write_simple)(MINICBOR_WRITE_ARGS, Node->Integer);
+			break;
+		case MCE_FLOAT:
+			Status = MINICBOR(write_float)(MINICBOR_WRITE_ARGS, Node->Real);
+			break;
+		default: __builtin_unreachable();
+		}
+		if (Status < 0) return Status;
+	}
+	return 0;
+}
@@ -0,0 +1,157 @@
+#ifndef MINICBOR_DOM_H
+#define MINICBOR_DOM_H
+
+#include "minicbor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A DOM is a tree of 16 byte nodes built from the reader callbacks into a single caller supplied arena, one node per data item in document order.
+ * Each node holds the item's type (a :c:type:`minicbor_event_t` value from :code:`MCE_POSITIVE` to :code:`MCE_FLOAT`, in bits 28-31 of :code:`Info`)
+ * and the index just past its subtree, i.e. of its next sibling (bits 0-27 of :code:`Info`). Top level items start at index 0.
+ *
+ * Nodes are allocated upwards from the start of the arena, and bytestrings and strings which arrive split into several pieces are copied downwards from its end.
+ * Other bytestrings and strings point directly into the input, which must then remain valid for as long as the DOM is used.
+ * Resetting the DOM releases everything at once.
+ */
+
+#define MINICBOR_DOM_MAX_INDEX 0xFFFFFFF
+
+#ifndef MINICBOR_DOM_DEPTH
+#define MINICBOR_DOM_DEPTH 64
+#endif
+
+/**
+ * :code:`Integer` holds the value of positive integers, the argument of negative integers (i.e. the value is :code:`-1 - Integer`), tag numbers and simple values.
+ * :code:`Size` holds the length of bytestrings and strings, the number of items in arrays and the number of key-value pairs in maps, and is :code:`0` for other items.
+ * The items of an array, map or tag follow its node directly, with each key followed by its value.
+ */
+typedef struct {
+	union {
+		uint64_t Integer;
+		double Real;
+		const unsigned char *Bytes;
+	};
+	uint32_t Size, Info;
+} minicbor_dom_node_t;
+
+/**
+ * An open array, map or tag (a container of one item) while building. Total is :code:`SIZE_MAX` for indefinite arrays and maps.
+ */
+typedef struct {
+	size_t Node, Items, Total;
+} minicbor_dom_frame_t;
+
+typedef struct {
+	minicbor_dom_node_t *Nodes;
+	unsigned char *Limit, *End;
+	size_t Count;
+
+	/**
+	 * :code:`NULL` while the DOM is valid, otherwise a description of the first error.
+	 */
+	const char *Error;
+
+	const unsigned char *Piece;
+	size_t Length;
+	int Depth, Pending, Copying;
+#ifdef MINICBOR_MAX_DEPTH
+	int Ends;
+#endif
+	minicbor_dom_frame_t Stack[MINICBOR_DOM_DEPTH];
+} minicbor_dom_t;
+
+/**
+ * Initializes :code:`Dom` to build into the :code:`Size` bytes at :code:`Arena`.
+ */
+void MINICBOR(dom_init)(minicbor_dom_t *Dom, void *Arena, size_t Size);
+
+/**
+ * Releases every node and copied string in :code:`Dom` so that it can be built again, without touching the arena.
+ */
+static inline void MINICBOR(dom_reset)(minicbor_dom_t *Dom) {
+	Dom->Limit = Dom->End;
+	Dom->Count = 0;
+	Dom->Error = NULL;
+	Dom->Depth = Dom->Pending = Dom->Copying = 0;
+#ifdef MINICBOR_MAX_DEPTH
+	Dom->Ends = 0;
+#endif
+}
+
+/**
+ * Builder functions with the same arguments as the corresponding reader callbacks.
+ * Items are ignored once an error has occurred, the arena is full, :c:macro:`MINICBOR_DOM_DEPTH` is exceeded or there are more than :c:macro:`MINICBOR_DOM_MAX_INDEX` nodes.
+ * When :c:macro:`MINICBOR_READ_FN_PREFIX` or :c:macro:`MINICBOR_READDATA_TYPE` is defined, the application's callbacks should call these directly.
+ */
+void MINICBOR(dom_positive_fn)(minicbor_dom_t *Dom, uint64_t Number);
+void MINICBOR(dom_negative_fn)(minicbor_dom_t *Dom, uint64_t Number);
+void MINICBOR(dom_bytes_fn)(minicbor_dom_t *Dom, size_t Size);
+void MINICBOR(dom_bytes_piece_fn)(minicbor_dom_t *Dom, const void *Bytes, size_t Size, int Final);
+void MINICBOR(dom_string_fn)(minicbor_dom_t *Dom, size_t Size);
+void MINICBOR(dom_string_piece_fn)(minicbor_dom_t *Dom, const void *Bytes, size_t Size, int Final);
+void MINICBOR(dom_array_fn)(minicbor_dom_t *Dom, size_t Size);
+void MINICBOR(dom_map_fn)(minicbor_dom_t *Dom, size_t Size);
+void MINICBOR(dom_tag_fn)(minicbor_dom_t *Dom, uint64_t Tag);
+void MINICBOR(dom_simple_fn)(minicbor_dom_t *Dom, int Value);
+void MINICBOR(dom_float_fn)(minicbor_dom_t *Dom, double Number);
+void MINICBOR(dom_break_fn)(minicbor_dom_t *Dom);
+#ifdef MINICBOR_MAX_DEPTH
+void MINICBOR(dom_end_fn)(minicbor_dom_t *Dom);
+#endif
+void MINICBOR(dom_error_fn)(minicbor_dom_t *Dom, int Position, const char *Message);
+
+#if !defined(MINICBOR_READ_FN_PREFIX) && !defined(MINICBOR_READDATA_TYPE)
+
+/**
+ * Resets :code:`Dom` and initializes :code:`Reader` to build it from the input passed to :c:func:`minicbor_read()`, which may be split into any number of blocks.
+ */
+void MINICBOR(dom_reader_init)(minicbor_reader_t *Reader, minicbor_dom_t *Dom);
+
+/**
+ * Resets :code:`Dom` and builds it from the complete CBOR sequence in :code:`Bytes`.
+ * Returns :code:`0` on success, otherwise :code:`-1` with :code:`Dom->Error` set.
+ */
+int MINICBOR(dom_parse)(minicbor_dom_t *Dom, const void *Bytes, size_t Size);
+
+#endif
+
+/**
+ * Returns 1 if no error has occurred and every item started has been completed.
+ */
+static inline int MINICBOR(dom_complete)(const minicbor_dom_t *Dom) {
+	return !Dom->Error && !Dom->Depth && !Dom->Pending;
+}
+
+static inline unsigned MINICBOR(dom_type)(const minicbor_dom_t *Dom, size_t Index) {
+	return Dom->Nodes[Index].Info >> 28;
+}
+
+static inline size_t MINICBOR(dom_next)(const minicbor_dom_t *Dom, size_t Index) {
+	return Dom->Nodes[Index].Info & MINICBOR_DOM_MAX_INDEX;
+}
+
+/**
+ * Returns the index of item :code:`Position` in the array at :code:`Index`, or :code:`SIZE_MAX` if there is no such item.
+ */
+size_t MINICBOR(dom_index)(const minicbor_dom_t *Dom, size_t Index, size_t Position);
+
+/**
+ * Returns the index of the value for the text string key :code:`Key` of :code:`Length` bytes in the map at :code:`Index`, or :code:`SIZE_MAX` if there is no such key.
+ */
+size_t MINICBOR(dom_get)(const minicbor_dom_t *Dom, size_t Index, const char *Key, size_t Length);
+
+/**
+ * Writes the item at :code:`Index` (and everything within it) using the write function.
+ * Arrays, maps, bytestrings and strings are written with definite lengths and floating point numbers as with :c:func:`minicbor_write_float()`.
+ * Returns :code:`0`, or the first negative value returned by the write function.
+ */
+int MINICBOR(dom_write)(const minicbor_dom_t *Dom, size_t Index, MINICBOR_WRITE_PARAMS);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,555 @@
+#ifndef MINICBOR_INTERNAL_H
+#define MINICBOR_INTERNAL_H
+
+#include "minicbor.h"
+#include <string.h>
+
+/*
+ * Definitions shared by minicbor_reader.c and minicbor_stream.c.
+ * Not part of the public API.
+ */
+
+typedef enum {
+	MCA_INVALID,
+	MCA_ARGUMENT,
+	MCA_POSITIVE,
+	MCA_NEGATIVE,
+	MCA_BYTES,
+	MCA_BYTES_INDEF,
+	MCA_STRING,
+	MCA_STRING_INDEF,
+	MCA_ARRAY,
+	MCA_ARRAY_INDEF,
+	MCA_MAP,
+	MCA_MAP_INDEF,
+	MCA_TAG,
+	MCA_SIMPLE,
+	MCA_BREAK
+} minicbor_action_t;
+
+/*
+ * Decoding information for an initial byte.
+ * Action selects what the decoder does with the byte, State is the next decoder state
+ * and Width is the number of argument bytes following the initial byte (for MCA_ARGUMENT).
+ * Immediate values (sizes, integers, tags, simple values) are the low 5 bits of the initial byte.
+ */
+typedef struct {
+	unsigned char Action, State, Width;
+} minicbor_head_t;
+
+#define MINICBOR_ARGUMENTS(BASE, STATE) \
+	[BASE + 0x18] = {MCA_ARGUMENT, STATE, 1}, \
+	[BASE + 0x19] = {MCA_ARGUMENT, STATE, 2}, \
+	[BASE + 0x1A] = {MCA_ARGUMENT, STATE, 4}, \
+	[BASE + 0x1B] = {MCA_ARGUMENT, STATE, 8}
+
+/*
+ * Initial byte table, unlisted bytes are not well-formed and decode as MCA_INVALID.
+ */
+static const minicbor_head_t MinicborHeads[256] = {
+	[0x00 ... 0x17] = {MCA_POSITIVE, MCS_DEFAULT, 0},
+	MINICBOR_ARGUMENTS(0x00, MCS_POSITIVE),
+	[0x20 ... 0x37] = {MCA_NEGATIVE, MCS_DEFAULT, 0},
+	MINICBOR_ARGUMENTS(0x20, MCS_NEGATIVE),
+	[0x40] = {MCA_BYTES, MCS_DEFAULT, 0},
+	[0x41 ... 0x57] = {MCA_BYTES, MCS_BYTES, 0},
+	MINICBOR_ARGUMENTS(0x40, MCS_BYTES_SIZE),
+	[0x5F] = {MCA_BYTES_INDEF, MCS_BYTES_INDEF, 0},
+	[0x60] = {MCA_STRING, MCS_DEFAULT, 0},
+	[0x61 ... 0x77] = {MCA_STRING, MCS_STRING, 0},
+	MINICBOR_ARGUMENTS(0x60, MCS_STRING_SIZE),
+	[0x7F] = {MCA_STRING_INDEF, MCS_STRING_INDEF, 0},
+	[0x80 ... 0x97] = {MCA_ARRAY, MCS_DEFAULT, 0},
+	MINICBOR_ARGUMENTS(0x80, MCS_ARRAY_SIZE),
+	[0x9F] = {MCA_ARRAY_INDEF, MCS_DEFAULT, 0},
+	[0xA0 ... 0xB7] = {MCA_MAP, MCS_DEFAULT, 0},
+	MINICBOR_ARGUMENTS(0xA0, MCS_MAP_SIZE),
+	[0xBF] = {MCA_MAP_INDEF, MCS_DEFAULT, 0},
+	[0xC0 ... 0xD7] = {MCA_TAG, MCS_DEFAULT, 0},
+	MINICBOR_ARGUMENTS(0xC0, MCS_TAG),
+	[0xE0 ... 0xF7] = {MCA_SIMPLE, MCS_DEFAULT, 0},
+	[0xF8] = {MCA_ARGUMENT, MCS_SIMPLE, 1},
+	[0xF9] = {MCA_ARGUMENT, MCS_FLOAT, 2},
+	[0xFA] = {MCA_ARGUMENT, MCS_FLOAT, 4},
+	[0xFB] = {MCA_ARGUMENT, MCS_FLOAT, 8},
+	[0xFF] = {MCA_BREAK, MCS_DEFAULT, 0}
+};
+
+#undef MINICBOR_ARGUMENTS
+
+/*
+ * Loads a big-endian argument of Width bytes directly from the input (Available >= Width),
+ * using a single unaligned load when at least 8 bytes remain.
+ */
+static inline uint64_t MINICBOR(load_argument)(const unsigned char *Next, size_t Width, size_t Available) {
+	if (Available >= 8) {
+		uint64_t Word;
+		memcpy(&Word, Next, 8);
+		return __builtin_bswap64(Word) >> (64 - 8 * Width);
+	} else switch (Width) {
+	case 1: return Next[0];
+	case 2: { uint16_t Word; memcpy(&Word, Next, 2); return __builtin_bswap16(Word); }
+	case 4: { uint32_t Word; memcpy(&Word, Next, 4); return __builtin_bswap32(Word); }
+	default: __builtin_unreachable();
+	}
+}
+
+/*
+ * Reads the big-endian argument of the current head into Argument, returning 1 once it is complete.
+ * If the whole argument is present in the input, it is loaded directly (with a single unaligned load when at least 8 bytes remain),
+ * otherwise the bytes are staged in Buffer (with Required tracking the bytes still needed) across calls.
+ */
+static inline int MINICBOR(read_argument)(unsigned char *Buffer, size_t *Required, size_t Width, const unsigned char **Bytes, size_t *Available, uint64_t *Argument) {
+	size_t Remaining = *Required;
+	const unsigned char *Next = *Bytes;
+	if (__builtin_expect(Remaining == Width && *Available >= Width, 1)) {
+		*Argument = MINICBOR(load_argument)(Next, Width, *Available);
+		*Bytes = Next + Width;
+		*Available -= Width;
+		return 1;
+	}
+	size_t Count = *Available < Remaining ? *Available : Remaining;
+	*Bytes = Next + Count;
+	*Available -= Count;
+	while (Count--) Buffer[--Remaining] = *Next++;
+	if (Remaining) {
+		*Required = Remaining;
+		return 0;
+	}
+	switch (Width) {
+	case 1: *Argument = *(uint8_t *)Buffer; break;
+	case 2: *Argument = *(uint16_t *)Buffer; break;
+	case 4: *Argument = *(uint32_t *)Buffer; break;
+	case 8: *Argument = *(uint64_t *)Buffer; break;
+	default: __builtin_unreachable();
+	}
+	return 1;
+}
+
+/*
+ * Skipping: Pending counts the items left to skip in the current frame, SIZE_MAX marks an indefinite frame which ends at a break.
+ * Definite arrays and maps within a definite frame are flattened into Pending, so only indefinite frames
+ * (and definite frames directly within them) are saved on Stack.
+ */
+
+enum {
+	MSK_HEAD,
+	MSK_ARGUMENT,
+	MSK_PAYLOAD
+};
+
+/*
+ * Returns 1 if a declared length or item count cannot be represented in a size_t,
+ * which also keeps SIZE_MAX free to mark indefinite items.
+ */
+static inline int MINICBOR(size_overflow)(uint64_t Size) {
+	return Size >= SIZE_MAX;
+}
+
+/*
+ * Counts an item as skipped, returning 1 once the skip is complete.
+ * The skip helpers take the current Pending count separately so that it can be kept in a local variable.
+ */
+static inline int MINICBOR(skip_item)(minicbor_skip_t *Skip, size_t *Pending) {
+	if (*Pending == SIZE_MAX) return 0;
+	if (--*Pending) return 0;
+	if (!Skip->Depth) return 1;
+	// Saved frames are always indefinite, so the completed frame does not count as an item here
+	*Pending = Skip->Stack[--Skip->Depth];
+	return 0;
+}
+
+static inline int MINICBOR(skip_open_indef)(minicbor_skip_t *Skip, size_t *Pending) {
+	if (Skip->Depth == MINICBOR_SKIP_DEPTH) return -1;
+	Skip->Stack[Skip->Depth++] = *Pending;
+	*Pending = SIZE_MAX;
+	return 0;
+}
+
+/*
+ * Opens a definite array or map with Count items (keys and values for maps), clamped below SIZE_MAX.
+ */
+static inline int MINICBOR(skip_open)(minicbor_skip_t *Skip, size_t *Pending, size_t Count) {
+	if (!Count) return MINICBOR(skip_item)(Skip, Pending);
+	if (*Pending == SIZE_MAX) {
+		if (Skip->Depth == MINICBOR_SKIP_DEPTH) return -1;
+		Skip->Stack[Skip->Depth++] = SIZE_MAX;
+		*Pending = Count;
+	} else {
+		size_t Remaining = *Pending - 1;
+		*Pending = Count < SIZE_MAX - 1 - Remaining ? Remaining + Count : SIZE_MAX - 1;
+	}
+	return 0;
+}
+
+static inline int MINICBOR(skip_break)(minicbor_skip_t *Skip, size_t *Pending) {
+	if (*Pending != SIZE_MAX) return -1;
+	if (!Skip->Depth) return 1;
+	*Pending = Skip->Stack[--Skip->Depth];
+	return MINICBOR(skip_item)(Skip, Pending);
+}
+
+/*
+ * Handles a complete argument for a head which started in decoder state Skip->Action.
+ */
+static inline int MINICBOR(skip_argument)(minicbor_skip_t *Skip, size_t *Pending) {
+	uint64_t Argument = Skip->Argument;
+	switch (Skip->Action) {
+	case MCS_BYTES_SIZE:
+	case MCS_STRING_SIZE:
+		if (!Argument) return MINICBOR(skip_item)(Skip, Pending);
+		Skip->Required = Argument < SIZE_MAX ? Argument : SIZE_MAX;
+		Skip->Phase = MSK_PAYLOAD;
+		return 0;
+	case MCS_ARRAY_SIZE:
+		return MINICBOR(skip_open)(Skip, Pending, Argument < SIZE_MAX ? Argument : SIZE_MAX - 1);
+	case MCS_MAP_SIZE:
+		return MINICBOR(skip_open)(Skip, Pending, Argument < SIZE_MAX / 2 ? 2 * Argument : SIZE_MAX - 1);
+	case MCS_TAG:
+		return 0;
+	default:
+		return MINICBOR(skip_item)(Skip, Pending);
+	}
+}
+
+/*
+ * Prepares Skip for skipping Count items from a decoder in state State, or the rest of the current item if the decoder is part way through one.
+ * Required, Width and Buffer are the decoder's corresponding fields. Returns 1 if there is nothing to skip.
+ */
+static inline int MINICBOR(skip_start)(minicbor_skip_t *Skip, minicbor_state_t State, size_t Required, size_t Width, const unsigned char *Buffer, size_t Count) {
+	Skip->Phase = MSK_HEAD;
+	Skip->Depth = 0;
+	Skip->Pending = Skip->Count = 1;
+	switch (State) {
+	case MCS_DEFAULT:
+		Skip->Pending = Skip->Count = Count;
+		return !Count;
+	case MCS_BYTES:
+	case MCS_STRING:
+		Skip->Phase = MSK_PAYLOAD;
+		Skip->Required = Required;
+		return 0;
+	case MCS_BYTES_INDEF:
+	case MCS_STRING_INDEF:
+		MINICBOR(skip_open_indef)(Skip, &Skip->Pending);
+		return 0;
+	case MCS_BYTES_CHUNK:
+	case MCS_STRING_CHUNK:
+		MINICBOR(skip_open_indef)(Skip, &Skip->Pending);
+		Skip->Phase = MSK_PAYLOAD;
+		Skip->Required = Required;
+		return 0;
+	case MCS_BYTES_CHUNK_SIZE:
+	case MCS_STRING_CHUNK_SIZE:
+		MINICBOR(skip_open_indef)(Skip, &Skip->Pending);
+		State = MCS_BYTES_SIZE;
+		// fallthrough
+	default: {
+		// Part way through an argument, the bytes read so far are staged in reverse in Buffer
+		uint64_t Argument = 0;
+		for (size_t I = Width; I-- > Required;) Argument = (Argument << 8) | Buffer[I];
+		Skip->Phase = MSK_ARGUMENT;
+		Skip->Action = State;
+		Skip->Argument = Argument;
+		Skip->Required = Required;
+		return 0;
+	}
+	}
+}
+
+/*
+ * Skips input until the items in Skip have been skipped, returning 1 once complete, 0 if more input is required or -1 if the input is invalid.
+ * Only the heads of items are decoded, string payloads are stepped over by length.
+ */
+static inline int MINICBOR(skip_input)(minicbor_skip_t *Skip, const unsigned char **Bytes, size_t *Available) {
+	const unsigned char *Next = *Bytes, *Limit = Next + *Available;
+	size_t Pending = Skip->Pending;
+	int Result = 0;
+	switch (Skip->Phase) {
+	case MSK_ARGUMENT: {
+		size_t Required = Skip->Required;
+		uint64_t Argument = Skip->Argument;
+		while (Required) {
+			if (Next == Limit) {
+				Skip->Required = Required;
+				Skip->Argument = Argument;
+				goto done;
+			}
+			Argument = (Argument << 8) | *Next++;
+			--Required;
+		}
+		Skip->Argument = Argument;
+		Skip->Phase = MSK_HEAD;
+		if ((Result = MINICBOR(skip_argument)(Skip, &Pending))) goto done;
+		if (Skip->Phase == MSK_HEAD) break;
+	}
+	// fallthrough
+	case MSK_PAYLOAD: {
+		size_t Count = Limit - Next;
+		if (Count < Skip->Required) {
+			Skip->Required -= Count;
+			Next = Limit;
+			goto done;
+		}
+		Next += Skip->Required;
+		Skip->Phase = MSK_HEAD;
+		if ((Result = MINICBOR(skip_item)(Skip, &Pending))) goto done;
+		break;
+	}
+	}
+	while (Next < Limit) {
+		unsigned char Byte = *Next++;
+		minicbor_head_t Head = MinicborHeads[Byte];
+		switch (Head.Action) {
+		case MCA_INVALID:
+			Result = -1;
+			break;
+		case MCA_ARGUMENT:
+			Skip->Action = Head.State;
+			if (Limit - Next < Head.Width) {
+				uint64_t Argument = 0;
+				Skip->Required = Head.Width - (Limit - Next);
+				while (Next < Limit) Argument = (Argument << 8) | *Next++;
+				Skip->Argument = Argument;
+				Skip->Phase = MSK_ARGUMENT;
+				goto done;
+			}
+			Skip->Argument = MINICBOR(load_argument)(Next, Head.Width, Limit - Next);
+			Next += Head.Width;
+			Result = MINICBOR(skip_argument)(Skip, &Pending);
+			if (Skip->Phase == MSK_PAYLOAD) {
+				if (Limit - Next < Skip->Required) {
+					Skip->Required -= Limit - Next;
+					Next = Limit;
+					goto done;
+				}
+				Next += Skip->Required;
+				Skip->Phase = MSK_HEAD;
+				Result = MINICBOR(skip_item)(Skip, &Pending);
+			}
+			break;
+		case MCA_POSITIVE:
+		case MCA_NEGATIVE:
+		case MCA_SIMPLE:
+			Result = MINICBOR(skip_item)(Skip, &Pending);
+			break;
+		case MCA_BYTES:
+		case MCA_STRING: {
+			size_t Size = Byte & 0x1F;
+			if (Limit - Next < Size) {
+				Skip->Required = Size - (Limit - Next);
+				Skip->Phase = MSK_PAYLOAD;
+				Next = Limit;
+				goto done;
+			}
+			Next += Size;
+			Result = MINICBOR(skip_item)(Skip, &Pending);
+			break;
+		}
+		case MCA_BYTES_INDEF:
+		case MCA_STRING_INDEF:
+		case MCA_ARRAY_INDEF:
+		case MCA_MAP_INDEF:
+			Result = MINICBOR(skip_open_indef)(Skip, &Pending);
+			break;
+		case MCA_ARRAY:
+			Result = MINICBOR(skip_open)(Skip, &Pending, Byte & 0x1F);
+			break;
+		case MCA_MAP:
+			Result = MINICBOR(skip_open)(Skip, &Pending, 2 * (Byte & 0x1F));
+			break;
+		case MCA_TAG:
+			break;
+		case MCA_BREAK:
+			Result = MINICBOR(skip_break)(Skip, &Pending);
+			break;
+		default: __builtin_unreachable();
+		}
+		if (Result) break;
+	}
+done:
+	Skip->Pending = Pending;
+	*Bytes = Next;
+	*Available = Limit - Next;
+	return Result;
+}
+
+/*
+ * Converts a half precision float to a double exactly, without libm.
+ * The exponent is rebiased and the mantissa shifted into place, infinities and NaNs keep their sign and payload.
+ * Subnormals are built as the normal number 2^-14 * (1 + Mantissa / 1024), then 2^-14 is subtracted exactly.
+ */
+static inline double MINICBOR(half_to_double)(uint16_t Half) {
+	uint64_t Bits = (uint64_t)(Half & 0x7FFF) << 42;
+	unsigned Exponent = Half & 0x7C00;
+	double Real;
+	if (__builtin_expect(Exponent - 0x400 < 0x7800, 1)) {
+		Bits += (uint64_t)(1023 - 15) << 52;
+	} else if (Exponent) {
+		Bits |= 0x7FF0000000000000;
+	} else {
+		Bits += (uint64_t)(1023 - 14) << 52;
+		memcpy(&Real, &Bits, 8);
+		Real -= 0x1p-14;
+		memcpy(&Bits, &Real, 8);
+	}
+	Bits |= (uint64_t)(Half & 0x8000) << 48;
+	memcpy(&Real, &Bits, 8);
+	return Real;
+}
+
+/*
+ * Converts Count half precision floats (big-endian, or little-endian if Little is set) at Bytes to doubles.
+ */
+static inline void MINICBOR(halves_to_doubles)(double *Values, const unsigned char *Bytes, size_t Count, int Little) {
+	for (size_t Index = 0; Index < Count; ++Index, Bytes += 2) {
+		uint16_t Half;
+		memcpy(&Half, Bytes, 2);
+		Values[Index] = MINICBOR(half_to_double)(Little ? Half : __builtin_bswap16(Half));
+	}
+}
+
+/*
+ * Converts the Width byte argument of a float head (already in host byte order) to a double.
+ */
+static inline double MINICBOR(decode_float)(size_t Width, uint64_t Bits) {
+	switch (Width) {
+	case 2: return MINICBOR(half_to_double)(Bits);
+	case 4: {
+		uint32_t Single = Bits;
+		float Value;
+		memcpy(&Value, &Single, 4);
+		return Value;
+	}
+	case 8: {
+		double Value;
+		memcpy(&Value, &Bits, 8);
+		return Value;
+	}
+	default: __builtin_unreachable();
+	}
+}
+
+#ifdef MINICBOR_VALIDATE_UTF8
+
+#define MINICBOR_UTF8_INVALID 0xFFFFFFFF
+
+/*
+ * Validates Size bytes of UTF-8 text continuing from State and returns the new state,
+ * or MINICBOR_UTF8_INVALID with the offset of the first invalid byte stored in Invalid.
+ * State is 0 at a code point boundary, otherwise the number of continuation bytes still expected in bits 0-1
+ * and the allowed range of the next one in bits 8-15 and 16-23 (which excludes overlong forms, surrogates and values above 0x10FFFF).
+ * Runs of ASCII are checked a word at a time.
+ */
+static inline uint32_t MINICBOR(utf8_validate)(uint32_t State, const unsigned char *Bytes, size_t Size, size_t *Invalid) {
+	const unsigned char *Next = Bytes, *Limit = Bytes + Size;
+	while (Next < Limit) {
+		if (!State) {
+			while (Limit - Next >= 8) {
+				uint64_t Word;
+				memcpy(&Word, Next, 8);
+				if (Word & 0x8080808080808080) break;
+				Next += 8;
+			}
+			if (Next == Limit) break;
+			unsigned char Byte = *Next;
+			if (Byte < 0x80) {
+				++Next;
+				continue;
+			}
+			switch (Byte) {
+			case 0xC2 ... 0xDF: State = 1 | 0x80 << 8 | 0xBF << 16; break;
+			case 0xE0: State = 2 | 0xA0 << 8 | 0xBF << 16; break;
+			case 0xE1 ... 0xEC: State = 2 | 0x80 << 8 | 0xBF << 16; break;
+			case 0xED: State = 2 | 0x80 << 8 | 0x9F << 16; break;
+			case 0xEE ... 0xEF: State = 2 | 0x80 << 8 | 0xBF << 16; break;
+			case 0xF0: State = 3 | 0x90 << 8 | 0xBF << 16; break;
+			case 0xF1 ... 0xF3: State = 3 | 0x80 << 8 | 0xBF << 16; break;
+			case 0xF4: State = 3 | 0x80 << 8 | 0x8F << 16; break;
+			default:
+				*Invalid = Next - Bytes;
+				return MINICBOR_UTF8_INVALID;
+			}
+		} else {
+			unsigned char Byte = *Next;
+			if (Byte < ((State >> 8) & 0xFF) || Byte > (State >> 16)) {
+				*Invalid = Next - Bytes;
+				return MINICBOR_UTF8_INVALID;
+			}
+			State = (State & 3) - 1;
+			if (State) State |= 0x80 << 8 | 0xBF << 16;
+		}
+		++Next;
+	}
+	return State;
+}
+
+#endif
+
+#ifdef MINICBOR_MAX_DEPTH
+
+/*
+ * Nesting tracking: MINICBOR(nest_item)() is called whenever a complete data item has been decoded,
+ * a container ends once the Remaining count of its level reaches 0.
+ */
+
+static inline void MINICBOR(nest_item)(minicbor_level_t *Stack, int Depth) {
+	if (Depth) --Stack[Depth - 1].Remaining;
+}
+
+/*
+ * Opens a level for an array or map with Size items (SIZE_MAX for indefinite), returning 0 if the maximum depth is exceeded.
+ */
+static inline int MINICBOR(nest_push)(minicbor_level_t *Stack, int *Depth, size_t Size, int Map) {
+	if (*Depth == MINICBOR_MAX_DEPTH) return 0;
+	minicbor_level_t *Level = Stack + (*Depth)++;
+	Level->Map = Map;
+	if (Size == SIZE_MAX) {
+		Level->Remaining = SIZE_MAX;
+		Level->Indef = 1;
+	} else {
+		if (Map) Size = Size > SIZE_MAX / 2 ? SIZE_MAX - 1 : 2 * Size;
+		Level->Remaining = Size;
+		Level->Indef = 0;
+	}
+	return 1;
+}
+
+/*
+ * Closes the current level on a break, returning 0 if there is no indefinite container to close
+ * (or if the break follows a key in an indefinite map).
+ */
+static inline int MINICBOR(nest_break)(minicbor_level_t *Stack, int Depth) {
+	if (!Depth) return 0;
+	minicbor_level_t *Level = Stack + Depth - 1;
+	if (!Level->Indef) return 0;
+	if (Level->Map && (SIZE_MAX - Level->Remaining) % 2) return 0;
+	Level->Remaining = 0;
+	return 1;
+}
+
+/*
+ * Accounts for Count skipped items (SIZE_MAX for all items up to a break), returning 0 if the skip consumed an unexpected break.
+ */
+static inline int MINICBOR(nest_skipped)(minicbor_level_t *Stack, int Depth, size_t Count) {
+	if (!Depth) return Count != SIZE_MAX;
+	minicbor_level_t *Level = Stack + Depth - 1;
+	if (Count == SIZE_MAX) {
+		if (!Level->Indef) return 0;
+		Level->Remaining = 0;
+	} else {
+		Level->Remaining = Count < Level->Remaining ? Level->Remaining - Count : 0;
+	}
+	return 1;
+}
+
+/*
+ * Returns 1 if the current level has ended.
+ */
+static inline int MINICBOR(nest_ended)(minicbor_level_t *Stack, int Depth) {
+	return Depth && !Stack[Depth - 1].Remaining;
+}
+
+#endif
+
+#endif
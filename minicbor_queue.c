@@ -0,0 +1,147 @@
+#include "minicbor_queue.h"
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+void MINICBOR(queue_init)(minicbor_queue_t *Queue, void *Buffer, size_t Size, struct iovec *Vector, int Capacity, size_t Threshold) {
+	Queue->Start = Queue->Next = Queue->Segment = (unsigned char *)Buffer;
+	Queue->End = Queue->Limit = Queue->Start + Size;
+	Queue->Vector = Vector;
+	Queue->Threshold = Threshold < Size / 2 ? Threshold : Size / 2;
+	Queue->First = Queue->Count = 0;
+	Queue->Capacity = Capacity;
+}
+
+static void MINICBOR(queue_append)(minicbor_queue_t *Queue, void *Bytes, size_t Size) {
+	struct iovec *Region = Queue->Vector + (Queue->First + Queue->Count++) % Queue->Capacity;
+	Region->iov_base = Bytes;
+	Region->iov_len = Size;
+}
+
+/*
+ * Queues the bytes written to the buffer since the last region.
+ * A free entry is always kept for this while the buffer can be written to, so once the vector is full End is set to Next to stop further writes.
+ */
+static void MINICBOR(queue_close)(minicbor_queue_t *Queue) {
+	if (Queue->Next > Queue->Segment) {
+		MINICBOR(queue_append)(Queue, Queue->Segment, Queue->Next - Queue->Segment);
+		Queue->Segment = Queue->Next;
+	}
+	if (Queue->Count == Queue->Capacity) Queue->End = Queue->Next;
+}
+
+/*
+ * Returns the start of the oldest queued bytes in the buffer, or NULL if none are.
+ */
+static unsigned char *MINICBOR(queue_oldest)(minicbor_queue_t *Queue) {
+	for (int Index = 0; Index < Queue->Count; ++Index) {
+		unsigned char *Base = Queue->Vector[(Queue->First + Index) % Queue->Capacity].iov_base;
+		if (Base >= Queue->Start && Base < Queue->Limit) return Base;
+	}
+	return Queue->Segment < Queue->Next ? Queue->Segment : NULL;
+}
+
+unsigned char *MINICBOR(queue_reserve)(minicbor_queue_t *Queue, size_t Size) {
+	if (Queue->Segment == Queue->Next && Queue->Count == Queue->Capacity) return NULL;
+	unsigned char *Oldest = MINICBOR(queue_oldest)(Queue);
+	if (!Oldest) {
+		Queue->Next = Queue->Segment = Queue->Start;
+		Queue->End = Queue->Limit;
+	} else if (Oldest < Queue->Next) {
+		// Queued bytes are contiguous, the space after them and before them is free
+		Queue->End = Queue->Limit;
+		if ((size_t)(Queue->Limit - Queue->Next) < Size && (size_t)(Oldest - Queue->Start) >= Size && Queue->Capacity - Queue->Count >= 2) {
+			MINICBOR(queue_close)(Queue);
+			Queue->Next = Queue->Segment = Queue->Start;
+			Queue->End = Oldest;
+		}
+	} else {
+		// Queued bytes wrap around, only the space up to the oldest is free
+		Queue->End = Oldest;
+	}
+	return (size_t)(Queue->End - Queue->Next) >= Size ? Queue->Next : NULL;
+}
+
+struct iovec *MINICBOR(queue_pending)(minicbor_queue_t *Queue, int *Count) {
+	MINICBOR(queue_close)(Queue);
+	int Contiguous = Queue->Capacity - Queue->First;
+	*Count = Queue->Count < Contiguous ? Queue->Count : Contiguous;
+	return Queue->Vector + Queue->First;
+}
+
+void MINICBOR(queue_consume)(minicbor_queue_t *Queue, size_t Size) {
+	while (Size && Queue->Count) {
+		struct iovec *Region = Queue->Vector + Queue->First;
+		if (Size < Region->iov_len) {
+			Region->iov_base = (unsigned char *)Region->iov_base + Size;
+			Region->iov_len -= Size;
+			return;
+		}
+		Size -= Region->iov_len;
+		Queue->First = (Queue->First + 1) % Queue->Capacity;
+		--Queue->Count;
+	}
+	if (MINICBOR(queue_empty)(Queue)) {
+		Queue->First = 0;
+		Queue->Next = Queue->Segment = Queue->Start;
+		Queue->End = Queue->Limit;
+	}
+}
+
+int MINICBOR(queue_send)(minicbor_queue_t *Queue, int Fd) {
+	for (;;) {
+		int Count;
+		struct iovec *Vector = MINICBOR(queue_pending)(Queue, &Count);
+		if (!Count) return 1;
+		ssize_t Written = writev(Fd, Vector, Count < IOV_MAX ? Count : IOV_MAX);
+		if (Written < 0) {
+			if (errno == EINTR) continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+			return -1;
+		}
+		MINICBOR(queue_consume)(Queue, Written);
+	}
+}
+
+/*
+ * Writes a head (unless Major is negative) and contents. Smaller contents are copied after the head, larger contents are queued by reference
+ * which needs up to 4 free entries: one if the head wraps around, one for the head, one for the contents and one kept free.
+ */
+static int MINICBOR(queue_content)(minicbor_queue_t *Queue, int Major, const void *Bytes, size_t Size) {
+	if (Size < Queue->Threshold) {
+		size_t Required = Size + (Major < 0 ? 0 : 9);
+		unsigned char *Next = (size_t)(Queue->End - Queue->Next) >= Required ? Queue->Next : MINICBOR(queue_reserve)(Queue, Required);
+		if (!Next) return -1;
+		if (Major >= 0) Next += MINICBOR(encode_head)(Next, Major, Size);
+		memcpy(Next, Bytes, Size);
+		Queue->Next = Next + Size;
+		return 0;
+	}
+	if (Queue->Capacity - Queue->Count < 4) return -1;
+	if (Major >= 0) {
+		unsigned char *Next = (size_t)(Queue->End - Queue->Next) >= 9 ? Queue->Next : MINICBOR(queue_reserve)(Queue, 9);
+		if (!Next) return -1;
+		Queue->Next = Next + MINICBOR(encode_head)(Next, Major, Size);
+	}
+	if (Size) {
+		MINICBOR(queue_close)(Queue);
+		MINICBOR(queue_append)(Queue, (void *)Bytes, Size);
+	}
+	return 0;
+}
+
+int MINICBOR(queue_write_data)(minicbor_queue_t *Queue, const void *Bytes, size_t Size) {
+	return MINICBOR(queue_content)(Queue, -1, Bytes, Size);
+}
+
+int MINICBOR(queue_write_bytes_data)(minicbor_queue_t *Queue, const void *Bytes, size_t Size) {
+	return MINICBOR(queue_content)(Queue, 2, Bytes, Size);
+}
+
+int MINICBOR(queue_write_string_data)(minicbor_queue_t *Queue, const char *String, size_t Length) {
+	return MINICBOR(queue_content)(Queue, 3, String, Length);
+}
@@ -0,0 +1,97 @@
+#ifndef MINICBOR_QUEUE_H
+#define MINICBOR_QUEUE_H
+
+#include "minicbor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A queue writer encodes into a bounded caller supplied buffer for non-blocking output, such as a socket driven by an event loop.
+ * Encoded bytes are queued as a list of regions (:c:type:`struct iovec`) which are written whenever the output is ready,
+ * in whole or in part, and larger payloads are queued by reference instead of being copied.
+ * Each write function either queues all of its output or nothing, returning :code:`-1` when the queue is full,
+ * so the same call can be repeated once some of the queue has been written.
+ *
+ * The buffer is used as a ring: space is reused as soon as the regions using it have been consumed.
+ */
+typedef struct {
+	unsigned char *Start, *Next, *End, *Limit;
+	unsigned char *Segment;
+	struct iovec *Vector;
+	size_t Threshold;
+	int First, Count, Capacity;
+} minicbor_queue_t;
+
+/**
+ * Initializes :code:`Queue` to encode into :code:`Size` bytes at :code:`Buffer` (at least 32 bytes), with room for :code:`Capacity` queued regions at :code:`Vector` (at least 4).
+ * Payloads of at least :code:`Threshold` bytes (at most half of :code:`Size`) are queued by reference and must remain valid until they have been consumed.
+ */
+void MINICBOR(queue_init)(minicbor_queue_t *Queue, void *Buffer, size_t Size, struct iovec *Vector, int Capacity, size_t Threshold);
+
+/**
+ * Returns the next regions to write, storing their number in :code:`Count` (:code:`0` if the queue is empty).
+ * Not all queued regions are necessarily returned at once.
+ * The regions are not modified by later writes to the queue, only by :c:func:`minicbor_queue_consume()`.
+ */
+struct iovec *MINICBOR(queue_pending)(minicbor_queue_t *Queue, int *Count);
+
+/**
+ * Removes the first :code:`Size` bytes written from the regions returned by :c:func:`minicbor_queue_pending()`, which may end within a region.
+ */
+void MINICBOR(queue_consume)(minicbor_queue_t *Queue, size_t Size);
+
+/**
+ * Writes as much of the queue as possible to the file descriptor :code:`Fd` with :c:func:`writev()`.
+ * Returns :code:`1` if the queue is now empty, :code:`0` if :c:func:`writev()` would block, or :code:`-1` on any other error (with :c:data:`errno` set).
+ */
+int MINICBOR(queue_send)(minicbor_queue_t *Queue, int Fd);
+
+/**
+ * Returns :code:`1` if everything queued has been consumed, otherwise :code:`0`.
+ */
+static inline int MINICBOR(queue_empty)(minicbor_queue_t *Queue) {
+	return !Queue->Count && Queue->Segment == Queue->Next;
+}
+
+/**
+ * Returns a pointer to :code:`Size` free contiguous bytes (at most half the buffer) or :code:`NULL` if the queue is full.
+ */
+unsigned char *MINICBOR(queue_reserve)(minicbor_queue_t *Queue, size_t Size);
+
+static inline int MINICBOR(queue_copy)(minicbor_queue_t *Queue, const void *Bytes, size_t Size) {
+	unsigned char *Next = (size_t)(Queue->End - Queue->Next) >= Size ? Queue->Next : MINICBOR(queue_reserve)(Queue, Size);
+	if (!Next) return -1;
+	memcpy(Next, Bytes, Size);
+	Queue->Next = Next + Size;
+	return 0;
+}
+
+/**
+ * Write the contents of a bytestring or string (after :c:func:`minicbor_queue_write_bytes()` or :c:func:`minicbor_queue_write_string()`), copied or queued by reference depending on their size.
+ */
+int MINICBOR(queue_write_data)(minicbor_queue_t *Queue, const void *Bytes, size_t Size);
+
+/**
+ * Write a bytestring or string together with its contents.
+ */
+int MINICBOR(queue_write_bytes_data)(minicbor_queue_t *Queue, const void *Bytes, size_t Size);
+int MINICBOR(queue_write_string_data)(minicbor_queue_t *Queue, const char *String, size_t Length);
+
+/*
+ * Queue equivalents of the minicbor_write_*() functions, returning 0 or -1 if the queue is full.
+ */
+#define MINICBOR_IMPL_PREFIX MINICBOR(queue_)
+#define MINICBOR_IMPL_SINK minicbor_queue_t *
+#define MINICBOR_IMPL_WRITE(QUEUE, BYTES, SIZE) MINICBOR(queue_copy)(QUEUE, BYTES, SIZE)
+#define MINICBOR_IMPL_RESERVE(QUEUE, SIZE) ((size_t)((QUEUE)->End - (QUEUE)->Next) >= (SIZE) ? (QUEUE)->Next : MINICBOR(queue_reserve)(QUEUE, SIZE))
+#define MINICBOR_IMPL_COMMIT(QUEUE, END) ((QUEUE)->Next = (END))
+#define MINICBOR_IMPL_NO_DATA
+#include "minicbor_writer_impl.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,5 +1,4 @@
-#include "minicbor.h"
-#include <math.h>
+#include "minicbor_internal.h"
 
 #ifdef MINICBOR_READ_FN_PREFIX
 
@@ -16,6 +15,7 @@
 #define FLOAT_FN MINICBOR_CONCAT(MINICBOR_READ_FN_PREFIX, float_fn)
 #define BREAK_FN MINICBOR_CONCAT(MINICBOR_READ_FN_PREFIX, break_fn)
 #define ERROR_FN MINICBOR_CONCAT(MINICBOR_READ_FN_PREFIX, error_fn)
+#define END_FN MINICBOR_CONCAT(MINICBOR_READ_FN_PREFIX, end_fn)
 
 #else
 
@@ -32,186 +32,209 @@
 #define FLOAT_FN Reader->Callbacks->FloatFn
 #define BREAK_FN Reader->Callbacks->BreakFn
 #define ERROR_FN Reader->Callbacks->ErrorFn
+#define END_FN Reader->Callbacks->EndFn
 
 #endif
 
+#ifdef MINICBOR_MAX_DEPTH
+
+#define NEST_ITEM() MINICBOR(nest_item)(Reader->Stack, Reader->Depth)
+
+#define NEST_PUSH(SIZE, MAP) \
+	if (!MINICBOR(nest_push)(Reader->Stack, &Reader->Depth, SIZE, MAP)) { \
+		Reader->State = MCS_INVALID; \
+		ERROR_FN(Reader->UserData, Reader->Position - Available, "Maximum nesting depth exceeded"); \
+		break; \
+	}
+
+#else
+
+#define NEST_ITEM() (void)0
+#define NEST_PUSH(SIZE, MAP)
+
+#endif
+
+/*
+ * Calls BytesFn() or StringFn() for an empty bytestring or string.
+ * The state is MCS_SKIP during the callback so that skipping from it does nothing instead of skipping the next item.
+ */
+#define EMPTY_FN(FN) \
+	Reader->State = MCS_SKIP; \
+	FN(Reader->UserData, 0); \
+	if (Reader->State == MCS_SKIP) Reader->State = MCS_DEFAULT; \
+	NEST_ITEM()
+
+#ifdef MINICBOR_VALIDATE_UTF8
+
+/*
+ * Validates a piece of a string, End is set if the piece completes the string or chunk (which must end on a code point boundary).
+ */
+static int MINICBOR(reader_utf8)(minicbor_reader_t *Reader, const unsigned char *Bytes, size_t Size, int End, size_t Available) {
+	size_t Invalid = Size;
+	uint32_t State = MINICBOR(utf8_validate)(Reader->Utf8, Bytes, Size, &Invalid);
+	if (State == MINICBOR_UTF8_INVALID || (End && State)) {
+		Reader->State = MCS_INVALID;
+		ERROR_FN(Reader->UserData, Reader->Position - Available + Invalid, "Invalid UTF-8 in string");
+		return 0;
+	}
+	Reader->Utf8 = State;
+	return 1;
+}
+
+#define VALIDATE_UTF8(SIZE, END) if (!MINICBOR(reader_utf8)(Reader, Bytes, SIZE, END, Available)) break
+
+#else
+
+#define VALIDATE_UTF8(SIZE, END)
+
+#endif
+
+#define CHECK_SIZE(SIZE) \
+	if (MINICBOR(size_overflow)(SIZE)) { \
+		Reader->State = MCS_INVALID; \
+		ERROR_FN(Reader->UserData, Reader->Position - Available, "Length too large"); \
+		break; \
+	}
+
+#define READ_ARGUMENT(ARGUMENT) MINICBOR(read_argument)(Reader->Buffer, &Reader->Required, Reader->Width, &Bytes, &Available, &ARGUMENT)
+
 int MINICBOR(read)(minicbor_reader_t *Reader, const unsigned char *Bytes, size_t Available) {
-	unsigned char *Buffer = Reader->Buffer;
 	Reader->Position += Available;
 	for (;;) {
 		if (Reader->State == MCS_FINISHED) {
 			Reader->Required = Available;
 			return 1;
+#ifdef MINICBOR_MAX_DEPTH
+		} else if (Reader->State == MCS_DEFAULT && MINICBOR(nest_ended)(Reader->Stack, Reader->Depth)) {
+			--Reader->Depth;
+			NEST_ITEM();
+			END_FN(Reader->UserData);
+#endif
 		} else if (!Available) {
 			return 0;
 		} else switch (Reader->State) {
 		case MCS_DEFAULT: {
 			unsigned char Byte = *Bytes++;
 			--Available;
-			switch (Byte) {
-			case 0x00 ... 0x17:
-				POSITIVE_FN(Reader->UserData, Byte - 0x00);
+			minicbor_head_t Head = MinicborHeads[Byte];
+			Reader->State = Head.State;
+			switch (Head.Action) {
+			case MCA_INVALID:
+				Reader->State = MCS_INVALID;
+				ERROR_FN(Reader->UserData, Reader->Position - Available, "Invalid initial byte");
 				break;
-			case 0x18 ... 0x1B:
-				Reader->Width = Reader->Required = 1 << (Byte - 0x18);
-				Reader->State = MCS_POSITIVE;
+			case MCA_ARGUMENT:
+				Reader->Width = Reader->Required = Head.Width;
 				break;
-			case 0x20 ... 0x37:
-				NEGATIVE_FN(Reader->UserData, Byte - 0x20);
+			case MCA_POSITIVE:
+				POSITIVE_FN(Reader->UserData, Byte & 0x1F);
+				NEST_ITEM();
 				break;
-			case 0x38 ... 0x3B:
-				Reader->Width = Reader->Required = 1 << (Byte - 0x38);
-				Reader->State = MCS_NEGATIVE;
+			case MCA_NEGATIVE:
+				NEGATIVE_FN(Reader->UserData, Byte & 0x1F);
+				NEST_ITEM();
 				break;
-			case 0x40 ... 0x57:
-				Reader->Required = Byte - 0x40;
-				Reader->State = Reader->Required ? MCS_BYTES : MCS_DEFAULT;
-				BYTES_FN(Reader->UserData, Reader->Required);
-				break;
-			case 0x58 ... 0x5B:
-				Reader->Width = Reader->Required = 1 << (Byte - 0x58);
-				Reader->State = MCS_BYTES_SIZE;
+			case MCA_BYTES:
+				Reader->Required = Byte & 0x1F;
+				if (Reader->Required) {
+					BYTES_FN(Reader->UserData, Reader->Required);
+				} else {
+					EMPTY_FN(BYTES_FN);
+				}
 				break;
-			case 0x5F:
-				Reader->State = MCS_BYTES_INDEF;
+			case MCA_BYTES_INDEF:
 				BYTES_FN(Reader->UserData, SIZE_MAX);
 				break;
-			case 0x60 ... 0x77:
-				Reader->Required = Byte - 0x60;
-				Reader->State = Reader->Required ? MCS_STRING : MCS_DEFAULT;
-				STRING_FN(Reader->UserData, Reader->Required);
-				break;
-			case 0x78 ... 0x7B:
-				Reader->Width = Reader->Required = 1 << (Byte - 0x78);
-				Reader->State = MCS_STRING_SIZE;
+			case MCA_STRING:
+				Reader->Required = Byte & 0x1F;
+				if (Reader->Required) {
+					STRING_FN(Reader->UserData, Reader->Required);
+				} else {
+					EMPTY_FN(STRING_FN);
+				}
 				break;
-			case 0x7F:
-				Reader->State = MCS_STRING_INDEF;
+			case MCA_STRING_INDEF:
 				STRING_FN(Reader->UserData, SIZE_MAX);
 				break;
-			case 0x80 ... 0x97:
-				ARRAY_FN(Reader->UserData, Byte - 0x80);
+			case MCA_ARRAY:
+				NEST_PUSH(Byte & 0x1F, 0);
+				ARRAY_FN(Reader->UserData, Byte & 0x1F);
 				break;
-			case 0x98 ... 0x9B:
-				Reader->Width = Reader->Required = 1 << (Byte - 0x98);
-				Reader->State = MCS_ARRAY_SIZE;
-				break;
-			case 0x9F:
+			case MCA_ARRAY_INDEF:
+				NEST_PUSH(SIZE_MAX, 0);
 				ARRAY_FN(Reader->UserData, SIZE_MAX);
 				break;
-			case 0xA0 ... 0xB7:
-				MAP_FN(Reader->UserData, Byte - 0xA0);
-				break;
-			case 0xB8 ... 0xBB:
-				Reader->Width = Reader->Required = 1 << (Byte - 0xB8);
-				Reader->State = MCS_MAP_SIZE;
+			case MCA_MAP:
+				NEST_PUSH(Byte & 0x1F, 1);
+				MAP_FN(Reader->UserData, Byte & 0x1F);
 				break;
-			case 0xBF:
+			case MCA_MAP_INDEF:
+				NEST_PUSH(SIZE_MAX, 1);
 				MAP_FN(Reader->UserData, SIZE_MAX);
 				break;
-			case 0xC0 ... 0xD7:
-				TAG_FN(Reader->UserData, Byte - 0xC0);
-				break;
-			case 0xD8 ... 0xDB:
-				Reader->Width = Reader->Required = 1 << (Byte - 0xD8);
-				Reader->State = MCS_TAG;
+			case MCA_TAG:
+				TAG_FN(Reader->UserData, Byte & 0x1F);
 				break;
-			case 0xE0 ... 0xF7:
-				SIMPLE_FN(Reader->UserData, Byte - 0xE0);
+			case MCA_SIMPLE:
+				SIMPLE_FN(Reader->UserData, Byte & 0x1F);
+				NEST_ITEM();
 				break;
-			case 0xF8:
-				Reader->State = MCS_SIMPLE;
-				break;
-			case 0xF9 ... 0xFB:
-				Reader->Width = Reader->Required = 1 << (Byte - 0xF8);
-				Reader->State = MCS_FLOAT;
-				break;
-			case 0xFF:
+			case MCA_BREAK:
+#ifdef MINICBOR_MAX_DEPTH
+				if (!MINICBOR(nest_break)(Reader->Stack, Reader->Depth)) {
+					Reader->State = MCS_INVALID;
+					ERROR_FN(Reader->UserData, Reader->Position - Available, "Unexpected break");
+				}
+#else
 				BREAK_FN(Reader->UserData);
+#endif
 				break;
+			default: __builtin_unreachable();
 			}
 			break;
 		}
 		case MCS_POSITIVE: {
-			size_t Required = Reader->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Bytes++;
-				--Available;
-			}
-			if (!Required) {
-				uint64_t Number = 0;
-				switch (Reader->Width) {
-				case 1: Number = *(uint8_t *)Buffer; break;
-				case 2: Number = *(uint16_t *)Buffer; break;
-				case 4: Number = *(uint32_t *)Buffer; break;
-				case 8: Number = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Number;
+			if (READ_ARGUMENT(Number)) {
 				Reader->State = MCS_DEFAULT;
 				POSITIVE_FN(Reader->UserData, Number);
-			} else {
-				Reader->Required = Required;
+				NEST_ITEM();
 			}
 			break;
 		}
 		case MCS_NEGATIVE: {
-			size_t Required = Reader->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Bytes++;
-				--Available;
-			}
-			if (!Required) {
-				uint64_t Number = 0;
-				switch (Reader->Width) {
-				case 1: Number = *(uint8_t *)Buffer; break;
-				case 2: Number = *(uint16_t *)Buffer; break;
-				case 4: Number = *(uint32_t *)Buffer; break;
-				case 8: Number = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Number;
+			if (READ_ARGUMENT(Number)) {
 				Reader->State = MCS_DEFAULT;
 				NEGATIVE_FN(Reader->UserData, Number);
-			} else {
-				Reader->Required = Required;
+				NEST_ITEM();
 			}
 			break;
 		}
 		case MCS_BYTES_SIZE: {
-			size_t Required = Reader->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Bytes++;
-				--Available;
-			}
-			if (!Required) {
-				size_t Size = 0;
-				switch (Reader->Width) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				if (Size) {
 					Reader->Required = Size;
 					Reader->State = MCS_BYTES;
+					BYTES_FN(Reader->UserData, Size);
 				} else {
-					Reader->State = MCS_DEFAULT;
+					EMPTY_FN(BYTES_FN);
 				}
-				BYTES_FN(Reader->UserData, Size);
-			} else {
-				Reader->Required = Required;
 			}
 			break;
 		}
 		case MCS_BYTES: {
 			size_t Required = Reader->Required;
 			if (Available < Required) {
-				BYTES_PIECE_FN(Reader->UserData, Bytes, Available, 0);
 				Reader->Required = Required - Available;
+				BYTES_PIECE_FN(Reader->UserData, Bytes, Available, 0);
 				Available = 0;
 			} else {
 				Reader->State = MCS_DEFAULT;
 				BYTES_PIECE_FN(Reader->UserData, Bytes, Required, 1);
+				NEST_ITEM();
 				Available -= Required;
 				Bytes += Required;
 			}
@@ -226,12 +249,13 @@ int MINICBOR(read)(minicbor_reader_t *Reader, const unsigned char *Bytes, size_t
 				Reader->State = MCS_BYTES_CHUNK;
 				break;
 			case 0x58 ... 0x5B:
-				Reader->Required = 1 << (Byte - 0x58);
+				Reader->Width = Reader->Required = 1 << (Byte - 0x58);
 				Reader->State = MCS_BYTES_CHUNK_SIZE;
 				break;
 			case 0xFF:
 				Reader->State = MCS_DEFAULT;
 				BYTES_PIECE_FN(Reader->UserData, Bytes, 0, 1);
+				NEST_ITEM();
 				break;
 			default:
 				Reader->State = MCS_INVALID;
@@ -241,32 +265,19 @@ int MINICBOR(read)(minicbor_reader_t *Reader, const unsigned char *Bytes, size_t
 			break;
 		}
 		case MCS_BYTES_CHUNK_SIZE: {
-			size_t Required = Reader->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Bytes++;
-				--Available;
-			}
-			if (!Required) {
-				size_t Size = 0;
-				switch (Reader->Width) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				Reader->Required = Size;
 				Reader->State = MCS_BYTES_CHUNK;
-			} else {
-				Reader->Required = Required;
 			}
 			break;
 		}
 		case MCS_BYTES_CHUNK: {
 			size_t Required = Reader->Required;
 			if (Available < Required) {
-				BYTES_PIECE_FN(Reader->UserData, Bytes, Available, 0);
 				Reader->Required = Required - Available;
+				BYTES_PIECE_FN(Reader->UserData, Bytes, Available, 0);
 				Available = 0;
 			} else {
 				Reader->State = MCS_BYTES_INDEF;
@@ -277,41 +288,31 @@ int MINICBOR(read)(minicbor_reader_t *Reader, const unsigned char *Bytes, size_t
 			break;
 		}
 		case MCS_STRING_SIZE: {
-			size_t Required = Reader->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Bytes++;
-				--Available;
-			}
-			if (!Required) {
-				size_t Size = 0;
-				switch (Reader->Width) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				if (Size) {
 					Reader->Required = Size;
 					Reader->State = MCS_STRING;
+					STRING_FN(Reader->UserData, Size);
 				} else {
-					Reader->State = MCS_DEFAULT;
+					EMPTY_FN(STRING_FN);
 				}
-				STRING_FN(Reader->UserData, Size);
-			} else {
-				Reader->Required = Required;
 			}
 			break;
 		}
 		case MCS_STRING: {
 			size_t Required = Reader->Required;
 			if (Available < Required) {
-				STRING_PIECE_FN(Reader->UserData, Bytes, Available, 0);
+				VALIDATE_UTF8(Available, 0);
 				Reader->Required = Required - Available;
+				STRING_PIECE_FN(Reader->UserData, Bytes, Available, 0);
 				Available = 0;
 			} else {
+				VALIDATE_UTF8(Required, 1);
 				Reader->State = MCS_DEFAULT;
 				STRING_PIECE_FN(Reader->UserData, Bytes, Required, 1);
+				NEST_ITEM();
 				Available -= Required;
 				Bytes += Required;
 			}
@@ -326,12 +327,13 @@ int MINICBOR(read)(minicbor_reader_t *Reader, const unsigned char *Bytes, size_t
 				Reader->State = MCS_STRING_CHUNK;
 				break;
 			case 0x78 ... 0x7B:
-				Reader->Required = 1 << (Byte - 0x78);
+				Reader->Width = Reader->Required = 1 << (Byte - 0x78);
 				Reader->State = MCS_STRING_CHUNK_SIZE;
 				break;
 			case 0xFF:
 				Reader->State = MCS_DEFAULT;
 				STRING_PIECE_FN(Reader->UserData, Bytes, 0, 1);
+				NEST_ITEM();
 				break;
 			default:
 				Reader->State = MCS_INVALID;
@@ -341,34 +343,23 @@ int MINICBOR(read)(minicbor_reader_t *Reader, const unsigned char *Bytes, size_t
 			break;
 		}
 		case MCS_STRING_CHUNK_SIZE: {
-			size_t Required = Reader->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Bytes++;
-				--Available;
-			}
-			if (!Required) {
-				size_t Size = 0;
-				switch (Reader->Width) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				Reader->Required = Size;
 				Reader->State = MCS_STRING_CHUNK;
-			} else {
-				Reader->Required = Required;
 			}
 			break;
 		}
 		case MCS_STRING_CHUNK: {
 			size_t Required = Reader->Required;
 			if (Available < Required) {
-				STRING_PIECE_FN(Reader->UserData, Bytes, Available, 0);
+				VALIDATE_UTF8(Available, 0);
 				Reader->Required = Required - Available;
+				STRING_PIECE_FN(Reader->UserData, Bytes, Available, 0);
 				Available = 0;
 			} else {
+				VALIDATE_UTF8(Required, 1);
 				Reader->State = MCS_STRING_INDEF;
 				STRING_PIECE_FN(Reader->UserData, Bytes, Required, 0);
 				Available -= Required;
@@ -377,70 +368,32 @@ int MINICBOR(read)(minicbor_reader_t *Reader, const unsigned char *Bytes, size_t
 			break;
 		}
 		case MCS_ARRAY_SIZE: {
-			size_t Required = Reader->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Bytes++;
-				--Available;
-			}
-			if (!Required) {
-				size_t Size = 0;
-				switch (Reader->Width) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				Reader->Required = Size;
 				Reader->State = MCS_DEFAULT;
+				NEST_PUSH(Size, 0);
 				ARRAY_FN(Reader->UserData, Size);
-			} else {
-				Reader->Required = Required;
 			}
 			break;
 		}
 		case MCS_MAP_SIZE: {
-			size_t Required = Reader->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Bytes++;
-				--Available;
-			}
-			if (!Required) {
-				size_t Size = 0;
-				switch (Reader->Width) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				Reader->Required = Size;
 				Reader->State = MCS_DEFAULT;
+				NEST_PUSH(Size, 1);
 				MAP_FN(Reader->UserData, Size);
-			} else {
-				Reader->Required = Required;
 			}
 			break;
 		}
 		case MCS_TAG: {
-			size_t Required = Reader->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Bytes++;
-				--Available;
-			}
-			if (!Required) {
-				uint64_t Tag = 0;
-				switch (Reader->Width) {
-				case 1: Tag = *(uint8_t *)Buffer; break;
-				case 2: Tag = *(uint16_t *)Buffer; break;
-				case 4: Tag = *(uint32_t *)Buffer; break;
-				case 8: Tag = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Tag;
+			if (READ_ARGUMENT(Tag)) {
 				Reader->State = MCS_DEFAULT;
 				TAG_FN(Reader->UserData, Tag);
-			} else {
-				Reader->Required = Required;
 			}
 			break;
 		}
@@ -449,39 +402,32 @@ int MINICBOR(read)(minicbor_reader_t *Reader, const unsigned char *Bytes, size_t
 			--Available;
 			Reader->State = MCS_DEFAULT;
 			SIMPLE_FN(Reader->UserData, Value);
+			NEST_ITEM();
 			break;
 		}
 		case MCS_FLOAT: {
-			size_t Required = Reader->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Bytes++;
-				--Available;
-			}
-			if (!Required) {
-				double Number = 0;
-				switch (Reader->Width) {
-				case 2: {
-					int Half = (Buffer[1] << 8) + Buffer[0];
-					int Exp = (Half >> 10) & 0x1F;
-					int Mant = Half & 0x3FF;
-					if (Exp == 0) {
-						Number = ldexp(Mant, -24);
-					} else if (Exp != 31) {
-						Number = ldexp(Mant + 1024, Exp - 25);
-					} else {
-						Number = Mant ? NAN : INFINITY;
-					}
-					if (Half & 0x8000) Number = -Number;
-					break;
-				}
-				case 4: Number = *(float *)Buffer; break;
-				case 8: Number = *(double *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Bits;
+			if (READ_ARGUMENT(Bits)) {
+				double Number = MINICBOR(decode_float)(Reader->Width, Bits);
 				Reader->State = MCS_DEFAULT;
 				FLOAT_FN(Reader->UserData, Number);
-			} else {
-				Reader->Required = Required;
+				NEST_ITEM();
+			}
+			break;
+		}
+		case MCS_SKIP: {
+			int Result = MINICBOR(skip_input)(&Reader->Skip, &Bytes, &Available);
+			if (Result < 0) {
+				Reader->State = MCS_INVALID;
+				ERROR_FN(Reader->UserData, Reader->Position - Available, "Invalid data in skipped item");
+			} else if (Result) {
+				Reader->State = MCS_DEFAULT;
+#ifdef MINICBOR_MAX_DEPTH
+				if (!MINICBOR(nest_skipped)(Reader->Stack, Reader->Depth, Reader->Skip.Count)) {
+					Reader->State = MCS_INVALID;
+					ERROR_FN(Reader->UserData, Reader->Position - Available, "Unexpected break");
+				}
+#endif
 			}
 			break;
 		}
@@ -496,3 +442,31 @@ int MINICBOR(read)(minicbor_reader_t *Reader, const unsigned char *Bytes, size_t
 	}
 	return 0;
 }
+
+void MINICBOR(reader_skip_items)(minicbor_reader_t *Reader, size_t Count) {
+	switch (Reader->State) {
+	case MCS_INVALID:
+	case MCS_FINISHED:
+	case MCS_SKIP:
+		return;
+	default:
+#ifdef MINICBOR_VALIDATE_UTF8
+		Reader->Utf8 = 0;
+#endif
+		if (!MINICBOR(skip_start)(&Reader->Skip, Reader->State, Reader->Required, Reader->Width, Reader->Buffer, Count)) Reader->State = MCS_SKIP;
+		return;
+	}
+}
+
+int MINICBOR(reader_end)(minicbor_reader_t *Reader) {
+	if (Reader->State == MCS_INVALID) return 1;
+#ifdef MINICBOR_MAX_DEPTH
+	if (Reader->State == MCS_DEFAULT && !Reader->Depth) return 0;
+#else
+	if (Reader->State == MCS_DEFAULT) return 0;
+#endif
+	if (Reader->State == MCS_FINISHED) return 0;
+	Reader->State = MCS_INVALID;
+	ERROR_FN(Reader->UserData, Reader->Position, "Unexpected end of input");
+	return 1;
+}
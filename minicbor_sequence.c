@@ -0,0 +1,256 @@
+#include "minicbor_internal.h"
+#include "minicbor_sequence.h"
+#include <pthread.h>
+#include <unistd.h>
+
+size_t MINICBOR(sequence_split)(const void *Data, size_t Size, size_t *Ends, size_t Capacity) {
+	const unsigned char *Bytes = (const unsigned char *)Data, *Next = Bytes;
+	size_t Available = Size, Count = 0;
+	minicbor_skip_t Skip;
+	while (Available) {
+		MINICBOR(skip_start)(&Skip, MCS_DEFAULT, 0, 0, NULL, 1);
+		if (MINICBOR(skip_input)(&Skip, &Next, &Available) != 1) return SIZE_MAX;
+		if (Count < Capacity) Ends[Count] = Next - Bytes;
+		++Count;
+	}
+	return Count;
+}
+
+/*
+ * State shared by the workers of a decode. Batches are claimed by atomically advancing Next,
+ * Delivered is the first item of the next batch to pass to BatchFn and is protected by Lock, as are changes to Status.
+ */
+typedef struct {
+	const unsigned char *Bytes;
+	const size_t *Ends;
+	size_t Count, Batch, Next, Delivered;
+	minicbor_sequence_item_fn ItemFn;
+	minicbor_sequence_batch_fn BatchFn;
+	void *UserData;
+	pthread_mutex_t Lock[1];
+	pthread_cond_t Ready[1];
+	int Status;
+} minicbor_sequence_t;
+
+typedef struct {
+	minicbor_sequence_t *Sequence;
+	int Worker;
+} minicbor_sequence_worker_t;
+
+static void MINICBOR(sequence_fail)(minicbor_sequence_t *Sequence, int Status) {
+	pthread_mutex_lock(Sequence->Lock);
+	if (!Sequence->Status) __atomic_store_n(&Sequence->Status, Status, __ATOMIC_RELAXED);
+	pthread_cond_broadcast(Sequence->Ready);
+	pthread_mutex_unlock(Sequence->Lock);
+}
+
+/*
+ * Waits until every earlier batch has been delivered, then delivers the batch of Count items from First.
+ */
+static int MINICBOR(sequence_deliver)(minicbor_sequence_t *Sequence, size_t First, size_t Count) {
+	pthread_mutex_lock(Sequence->Lock);
+	while (Sequence->Delivered != First && !Sequence->Status) pthread_cond_wait(Sequence->Ready, Sequence->Lock);
+	int Status = Sequence->Status;
+	pthread_mutex_unlock(Sequence->Lock);
+	if (Status) return Status;
+	// No other worker can deliver until Delivered is advanced
+	if ((Status = Sequence->BatchFn(Sequence->UserData, First, Count))) return Status;
+	pthread_mutex_lock(Sequence->Lock);
+	Sequence->Delivered = First + Count;
+	pthread_cond_broadcast(Sequence->Ready);
+	pthread_mutex_unlock(Sequence->Lock);
+	return 0;
+}
+
+static void *MINICBOR(sequence_work)(void *Arg) {
+	minicbor_sequence_worker_t *Worker = (minicbor_sequence_worker_t *)Arg;
+	minicbor_sequence_t *Sequence = Worker->Sequence;
+	const size_t *Ends = Sequence->Ends;
+	while (!__atomic_load_n(&Sequence->Status, __ATOMIC_RELAXED)) {
+		size_t First = __atomic_fetch_add(&Sequence->Next, Sequence->Batch, __ATOMIC_RELAXED);
+		if (First >= Sequence->Count) break;
+		size_t Last = Sequence->Count - First > Sequence->Batch ? First + Sequence->Batch : Sequence->Count;
+		int Status = 0;
+		for (size_t Index = First; Index < Last; ++Index) {
+			size_t Start = Index ? Ends[Index - 1] : 0;
+			if ((Status = Sequence->ItemFn(Sequence->UserData, Worker->Worker, Index, Sequence->Bytes + Start, Ends[Index] - Start))) break;
+		}
+		if (!Status && Sequence->BatchFn) Status = MINICBOR(sequence_deliver)(Sequence, First, Last - First);
+		if (Status) {
+			MINICBOR(sequence_fail)(Sequence, Status);
+			break;
+		}
+	}
+	return NULL;
+}
+
+int MINICBOR(sequence_decode)(const void *Bytes, const size_t *Ends, size_t Count, int Workers, size_t Batch, minicbor_sequence_item_fn ItemFn, minicbor_sequence_batch_fn BatchFn, void *UserData) {
+	if (!Count) return 0;
+	if (!Batch) Batch = 1;
+	if (Workers <= 0) {
+		long Processors = sysconf(_SC_NPROCESSORS_ONLN);
+		Workers = Processors > 0 ? Processors : 1;
+	}
+	// There is no point in having more workers than batches
+	size_t Batches = (Count - 1) / Batch + 1;
+	if ((size_t)Workers > Batches) Workers = Batches;
+	minicbor_sequence_t Sequence = {
+		.Bytes = (const unsigned char *)Bytes,
+		.Ends = Ends,
+		.Count = Count,
+		.Batch = Batch,
+		.ItemFn = ItemFn,
+		.BatchFn = BatchFn,
+		.UserData = UserData
+	};
+	pthread_mutex_init(Sequence.Lock, NULL);
+	pthread_cond_init(Sequence.Ready, NULL);
+	pthread_t Threads[Workers];
+	minicbor_sequence_worker_t Args[Workers];
+	int Started = 1;
+	for (; Started < Workers; ++Started) {
+		Args[Started].Sequence = &Sequence;
+		Args[Started].Worker = Started;
+		// If a thread cannot be created, the remaining workers do the work
+		if (pthread_create(Threads + Started, NULL, MINICBOR(sequence_work), Args + Started)) break;
+	}
+	Args[0].Sequence = &Sequence;
+	Args[0].Worker = 0;
+	MINICBOR(sequence_work)(Args);
+	for (int Worker = 1; Worker < Started; ++Worker) pthread_join(Threads[Worker], NULL);
+	pthread_cond_destroy(Sequence.Ready);
+	pthread_mutex_destroy(Sequence.Lock);
+	return Sequence.Status;
+}
+
+/*
+ * Skips the item starting at *Offset, returning 0 if it is invalid or truncated.
+ */
+static inline int MINICBOR(sequence_skip)(const unsigned char *Bytes, size_t Size, size_t *Offset) {
+	const unsigned char *Next = Bytes + *Offset;
+	size_t Available = Size - *Offset;
+	minicbor_skip_t Skip;
+	MINICBOR(skip_start)(&Skip, MCS_DEFAULT, 0, 0, NULL, 1);
+	if (MINICBOR(skip_input)(&Skip, &Next, &Available) != 1) return 0;
+	*Offset = Next - Bytes;
+	return 1;
+}
+
+/*
+ * A chunk of the input for a parallel split. Each chunk is first scanned speculatively from the first candidate offset that parses
+ * up to its Limit, recording the start, the offset of the first item start at or past Limit (Exit) and the number of items.
+ * Once reconciled, Start is the true offset of the first item start in the chunk and First the index of that item.
+ */
+typedef struct {
+	const unsigned char *Bytes;
+	size_t *Ends;
+	size_t Size, Capacity, Base, Limit, Start, Exit, Count, First;
+	int Valid;
+} minicbor_sequence_chunk_t;
+
+static void *MINICBOR(sequence_speculate)(void *Arg) {
+	minicbor_sequence_chunk_t *Chunk = (minicbor_sequence_chunk_t *)Arg;
+	size_t Last = Chunk->Limit - Chunk->Base > MINICBOR_SEQUENCE_CANDIDATES ? Chunk->Base + MINICBOR_SEQUENCE_CANDIDATES : Chunk->Limit;
+	for (size_t Start = Chunk->Base; Start < Last; ++Start) {
+		size_t Offset = Start, Count = 0;
+		while (Offset < Chunk->Limit && MINICBOR(sequence_skip)(Chunk->Bytes, Chunk->Size, &Offset)) ++Count;
+		if (Offset >= Chunk->Limit) {
+			Chunk->Start = Start;
+			Chunk->Exit = Offset;
+			Chunk->Count = Count;
+			Chunk->Valid = 1;
+			return NULL;
+		}
+	}
+	Chunk->Valid = 0;
+	return NULL;
+}
+
+/*
+ * Adjusts the speculative scan of Chunk for its true first item start Entry, following the true path and the speculative path
+ * in step until they meet (after which they are identical) or the true path leaves the chunk. Returns 0 if the input is invalid.
+ */
+static int MINICBOR(sequence_reconcile)(minicbor_sequence_chunk_t *Chunk, size_t Entry) {
+	size_t True = Entry, Speculative = Chunk->Start, TrueCount = 0, SpeculativeCount = 0;
+	Chunk->Start = Entry;
+	while (True < Chunk->Limit) {
+		if (Chunk->Valid && True == Speculative) {
+			Chunk->Count = TrueCount + Chunk->Count - SpeculativeCount;
+			return 1;
+		}
+		if (Chunk->Valid && Speculative < True) {
+			if (!MINICBOR(sequence_skip)(Chunk->Bytes, Chunk->Size, &Speculative)) return 0;
+			++SpeculativeCount;
+		} else {
+			if (!MINICBOR(sequence_skip)(Chunk->Bytes, Chunk->Size, &True)) return 0;
+			++TrueCount;
+		}
+	}
+	Chunk->Exit = True;
+	Chunk->Count = TrueCount;
+	return 1;
+}
+
+static void *MINICBOR(sequence_fill)(void *Arg) {
+	minicbor_sequence_chunk_t *Chunk = (minicbor_sequence_chunk_t *)Arg;
+	size_t Offset = Chunk->Start;
+	for (size_t Index = Chunk->First; Index < Chunk->First + Chunk->Count && Index < Chunk->Capacity; ++Index) {
+		MINICBOR(sequence_skip)(Chunk->Bytes, Chunk->Size, &Offset);
+		Chunk->Ends[Index] = Offset;
+	}
+	return NULL;
+}
+
+/*
+ * Runs Fn on each chunk, using a thread for every chunk except the first.
+ */
+static void MINICBOR(sequence_parallel)(minicbor_sequence_chunk_t *Chunks, int Count, void *(*Fn)(void *)) {
+	pthread_t Threads[Count];
+	int Started[Count];
+	for (int Index = 1; Index < Count; ++Index) Started[Index] = !pthread_create(Threads + Index, NULL, Fn, Chunks + Index);
+	Fn(Chunks);
+	for (int Index = 1; Index < Count; ++Index) {
+		if (Started[Index]) {
+			pthread_join(Threads[Index], NULL);
+		} else {
+			Fn(Chunks + Index);
+		}
+	}
+}
+
+size_t MINICBOR(sequence_split_parallel)(const void *Data, size_t Size, size_t *Ends, size_t Capacity, int Workers) {
+	if (Workers <= 0) {
+		long Processors = sysconf(_SC_NPROCESSORS_ONLN);
+		Workers = Processors > 0 ? Processors : 1;
+	}
+	if ((size_t)Workers > Size / MINICBOR_SEQUENCE_MIN_CHUNK) Workers = Size / MINICBOR_SEQUENCE_MIN_CHUNK;
+	if (Workers <= 1) return MINICBOR(sequence_split)(Data, Size, Ends, Capacity);
+	minicbor_sequence_chunk_t Chunks[Workers];
+	for (int Index = 0; Index < Workers; ++Index) {
+		minicbor_sequence_chunk_t *Chunk = Chunks + Index;
+		Chunk->Bytes = (const unsigned char *)Data;
+		Chunk->Ends = Ends;
+		Chunk->Size = Size;
+		Chunk->Capacity = Capacity;
+		Chunk->Base = (Size / Workers) * Index;
+		Chunk->Limit = Index == Workers - 1 ? Size : (Size / Workers) * (Index + 1);
+	}
+	MINICBOR(sequence_parallel)(Chunks, Workers, MINICBOR(sequence_speculate));
+	// The true path enters each chunk where it left the previous one, items are only ever skipped again where the paths differ
+	size_t Entry = 0, Total = 0;
+	for (int Index = 0; Index < Workers; ++Index) {
+		minicbor_sequence_chunk_t *Chunk = Chunks + Index;
+		if (Entry >= Chunk->Limit) {
+			Chunk->Start = Entry;
+			Chunk->Count = 0;
+		} else if (!MINICBOR(sequence_reconcile)(Chunk, Entry)) {
+			return SIZE_MAX;
+		} else {
+			Entry = Chunk->Exit;
+		}
+		Chunk->First = Total;
+		Total += Chunk->Count;
+	}
+	if (Capacity) MINICBOR(sequence_parallel)(Chunks, Workers, MINICBOR(sequence_fill));
+	return Total;
+}
@@ -0,0 +1,73 @@
+#ifndef MINICBOR_SEQUENCE_H
+#define MINICBOR_SEQUENCE_H
+
+#include "minicbor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Parallel decoding of CBOR sequences (RFC 8742) held in a single buffer, in two phases.
+ * :c:func:`minicbor_sequence_split()` first finds the end of each top level item by skipping, decoding only the heads of items.
+ * The first phase can itself be run in parallel with :c:func:`minicbor_sequence_split_parallel()`.
+ * :c:func:`minicbor_sequence_decode()` then hands out the items in batches to a pool of worker threads, each of which typically decodes its items with its own :c:type:`minicbor_reader_t` or :c:type:`minicbor_stream_t`.
+ */
+
+/**
+ * The minimum number of bytes per chunk for :c:func:`minicbor_sequence_split_parallel()`.
+ */
+#ifndef MINICBOR_SEQUENCE_MIN_CHUNK
+#define MINICBOR_SEQUENCE_MIN_CHUNK 65536
+#endif
+
+/**
+ * The number of offsets at the start of a chunk tried as speculative item starts by :c:func:`minicbor_sequence_split_parallel()`.
+ */
+#ifndef MINICBOR_SEQUENCE_CANDIDATES
+#define MINICBOR_SEQUENCE_CANDIDATES 16
+#endif
+
+/**
+ * Called by worker :code:`Worker` (from :code:`0` to the number of workers - 1) for item :code:`Index`, which is the :code:`Size` bytes at :code:`Bytes`.
+ * Items are called in order within a batch, batches are processed concurrently by different workers.
+ * Returning a nonzero value stops the decode.
+ */
+typedef int (*minicbor_sequence_item_fn)(void *UserData, int Worker, size_t Index, const unsigned char *Bytes, size_t Size);
+
+/**
+ * Called once the :code:`Count` items from :code:`First` have all been processed, in order of :code:`First` and never concurrently.
+ * Returning a nonzero value stops the decode.
+ */
+typedef int (*minicbor_sequence_batch_fn)(void *UserData, size_t First, size_t Count);
+
+/**
+ * Finds the top level items in the :code:`Size` bytes at :code:`Bytes`, storing the offset just past item :code:`I` in :code:`Ends[I]`.
+ * Returns the number of items, which may be more than :code:`Capacity` in which case only the first :code:`Capacity` offsets are stored.
+ * Returns :code:`SIZE_MAX` if an item is invalid or truncated.
+ * Items are only checked as far as needed to find their ends, nesting of indefinite items within definite ones is limited to :c:macro:`MINICBOR_SKIP_DEPTH`.
+ */
+size_t MINICBOR(sequence_split)(const void *Bytes, size_t Size, size_t *Ends, size_t Capacity);
+
+/**
+ * Equivalent to :c:func:`minicbor_sequence_split()`, splitting the input into one chunk per worker (at most one per :c:macro:`MINICBOR_SEQUENCE_MIN_CHUNK` bytes) which are scanned in parallel.
+ * Since an item may start anywhere in a chunk, each chunk is scanned speculatively from the first of its first :c:macro:`MINICBOR_SEQUENCE_CANDIDATES` offsets which parses up to the next chunk.
+ * The chunks are then reconciled in order: the true path enters each chunk where it left the previous one, and is followed only until it meets the speculative path (from where they are identical).
+ * If :code:`Capacity` is nonzero, the offsets are stored by a second parallel pass.
+ * Uses one worker per online processor if :code:`Workers` is not positive.
+ */
+size_t MINICBOR(sequence_split_parallel)(const void *Bytes, size_t Size, size_t *Ends, size_t Capacity, int Workers);
+
+/**
+ * Calls :code:`ItemFn` for each of the :code:`Count` items at :code:`Bytes` whose ends are given by :code:`Ends` (as found by :c:func:`minicbor_sequence_split()`),
+ * using :code:`Workers` threads (including the calling thread, or one per online processor if :code:`Workers` is not positive) which each take :code:`Batch` items at a time.
+ * If :code:`BatchFn` is not :code:`NULL`, it is called for each batch in order once the batch is complete, so that results can be delivered in order.
+ * Returns :code:`0` once every item has been processed, otherwise the first nonzero value returned by a callback.
+ */
+int MINICBOR(sequence_decode)(const void *Bytes, const size_t *Ends, size_t Count, int Workers, size_t Batch, minicbor_sequence_item_fn ItemFn, minicbor_sequence_batch_fn BatchFn, void *UserData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
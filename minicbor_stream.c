@@ -1,5 +1,4 @@
-#include "minicbor.h"
-#include <math.h>
+#include "minicbor_internal.h"
 #include <stdint.h>
 
 #define EVENT(TYPE) \
@@ -7,10 +6,108 @@
 	Stream->Next = Next; \
 	return MCE_ ## TYPE
 
+#ifdef MINICBOR_MAX_DEPTH
+
+#define NEST_ITEM() MINICBOR(nest_item)(Stream->Stack, Stream->Depth)
+
+#define NEST_PUSH(SIZE, MAP) \
+	if (!MINICBOR(nest_push)(Stream->Stack, &Stream->Depth, SIZE, MAP)) { \
+		Stream->State = MCS_INVALID; \
+		EVENT(ERROR); \
+	}
+
+#else
+
+#define NEST_ITEM() (void)0
+#define NEST_PUSH(SIZE, MAP)
+
+#endif
+
+#ifdef MINICBOR_VALIDATE_UTF8
+
+/*
+ * Validates a piece of a string, End is set if the piece completes the string or chunk (which must end on a code point boundary).
+ * On failure, Stream->Bytes is set to the first invalid byte (or the end of the piece for a truncated code point).
+ */
+static int MINICBOR(stream_utf8)(minicbor_stream_t *Stream, const unsigned char *Bytes, size_t Size, int End) {
+	size_t Invalid = Size;
+	uint32_t State = MINICBOR(utf8_validate)(Stream->Utf8, Bytes, Size, &Invalid);
+	if (State == MINICBOR_UTF8_INVALID || (End && State)) {
+		Stream->State = MCS_INVALID;
+		Stream->Bytes = Bytes + Invalid;
+		return 0;
+	}
+	Stream->Utf8 = State;
+	return 1;
+}
+
+#define VALIDATE_UTF8(SIZE, END) if (!MINICBOR(stream_utf8)(Stream, Next, SIZE, END)) { EVENT(ERROR); }
+
+#else
+
+#define VALIDATE_UTF8(SIZE, END)
+
+#endif
+
+#define CHECK_SIZE(SIZE) \
+	if (MINICBOR(size_overflow)(SIZE)) { \
+		Stream->State = MCS_INVALID; \
+		EVENT(ERROR); \
+	}
+
+#define READ_ARGUMENT(ARGUMENT) MINICBOR(read_argument)(Stream->Buffer, &Stream->Required, Stream->Size, &Next, &Available, &ARGUMENT)
+
+static int MINICBOR(stream_skip)(minicbor_stream_t *Stream) {
+	size_t Available = Stream->Available;
+	int Result = MINICBOR(skip_input)(&Stream->Skip, &Stream->Next, &Available);
+	Stream->Available = Available;
+	if (Result < 0) {
+		Stream->State = MCS_INVALID;
+	} else if (Result) {
+		Stream->State = MCS_DEFAULT;
+#ifdef MINICBOR_MAX_DEPTH
+		if (!MINICBOR(nest_skipped)(Stream->Stack, Stream->Depth, Stream->Skip.Count)) {
+			Stream->State = MCS_INVALID;
+			return -1;
+		}
+#endif
+	}
+	return Result;
+}
+
+int MINICBOR(skip_items)(minicbor_stream_t *Stream, size_t Count) {
+	switch (Stream->State) {
+	case MCS_INVALID:
+	case MCS_FINISHED:
+		return -1;
+	case MCS_SKIP:
+		break;
+	default:
+#ifdef MINICBOR_VALIDATE_UTF8
+		Stream->Utf8 = 0;
+#endif
+		if (MINICBOR(skip_start)(&Stream->Skip, Stream->State, Stream->Required, Stream->Size, Stream->Buffer, Count)) return 1;
+		Stream->State = MCS_SKIP;
+		break;
+	}
+	return MINICBOR(stream_skip)(Stream);
+}
+
 minicbor_event_t MINICBOR(next)(minicbor_stream_t *Stream) {
-	unsigned char *Buffer = Stream->Buffer;
-	unsigned Available = Stream->Available;
+	if (__builtin_expect(Stream->State == MCS_SKIP, 0)) {
+		int Result = MINICBOR(stream_skip)(Stream);
+		if (Result < 0) return MCE_ERROR;
+		if (!Result) return MCE_WAIT;
+	}
+	size_t Available = Stream->Available;
 	const unsigned char *Next = Stream->Next;
+#ifdef MINICBOR_MAX_DEPTH
+	if (Stream->State == MCS_DEFAULT && MINICBOR(nest_ended)(Stream->Stack, Stream->Depth)) {
+		--Stream->Depth;
+		NEST_ITEM();
+		return MCE_END;
+	}
+#endif
 	for (;;) {
 		if (!Available) {
 			EVENT(WAIT);
@@ -18,163 +115,116 @@ minicbor_event_t MINICBOR(next)(minicbor_stream_t *Stream) {
 		case MCS_DEFAULT: {
 			unsigned char Byte = *Next++;
 			--Available;
-			switch (Byte) {
-			case 0x00 ... 0x17:
-				Stream->Integer = Byte - 0x00;
-				EVENT(POSITIVE);
-			case 0x18 ... 0x1B:
-				Stream->Size = Stream->Required = 1 << (Byte - 0x18);
-				Stream->State = MCS_POSITIVE;
+			minicbor_head_t Head = MinicborHeads[Byte];
+			Stream->State = Head.State;
+			switch (Head.Action) {
+			case MCA_INVALID:
+				Stream->State = MCS_INVALID;
+				EVENT(ERROR);
+			case MCA_ARGUMENT:
+				Stream->Size = Stream->Required = Head.Width;
 				break;
-			case 0x20 ... 0x37:
-				Stream->Integer = Byte - 0x20;
+			case MCA_POSITIVE:
+				Stream->Integer = Byte & 0x1F;
+				NEST_ITEM();
+				EVENT(POSITIVE);
+			case MCA_NEGATIVE:
+				Stream->Integer = Byte & 0x1F;
+				NEST_ITEM();
 				EVENT(NEGATIVE);
-			case 0x38 ... 0x3B:
-				Stream->Size = Stream->Required = 1 << (Byte - 0x38);
-				Stream->State = MCS_NEGATIVE;
-				break;
-			case 0x40 ... 0x57:
-				Stream->Required = Byte - 0x40;
-				Stream->State = Stream->Required ? MCS_BYTES : MCS_DEFAULT;
+			case MCA_BYTES:
+				Stream->Size = Stream->Required = Byte & 0x1F;
+				if (!Stream->Size) NEST_ITEM();
 				EVENT(BYTES);
-			case 0x58 ... 0x5B:
-				Stream->Size = Stream->Required = 1 << (Byte - 0x58);
-				Stream->State = MCS_BYTES_SIZE;
-				break;
-			case 0x5F:
-				Stream->State = MCS_BYTES_INDEF;
+			case MCA_BYTES_INDEF:
 				Stream->Size = Stream->Required = SIZE_MAX;
 				EVENT(BYTES);
-			case 0x60 ... 0x77:
-				Stream->Required = Byte - 0x60;
-				Stream->State = Stream->Required ? MCS_STRING : MCS_DEFAULT;
+			case MCA_STRING:
+				Stream->Size = Stream->Required = Byte & 0x1F;
+				if (!Stream->Size) NEST_ITEM();
 				EVENT(STRING);
-			case 0x78 ... 0x7B:
-				Stream->Size = Stream->Required = 1 << (Byte - 0x78);
-				Stream->State = MCS_STRING_SIZE;
-				break;
-			case 0x7F:
-				Stream->State = MCS_STRING_INDEF;
+			case MCA_STRING_INDEF:
 				Stream->Size = Stream->Required = SIZE_MAX;
 				EVENT(STRING);
-			case 0x80 ... 0x97:
-				Stream->Size = Stream->Required = Byte - 0x80;
+			case MCA_ARRAY:
+				Stream->Size = Stream->Required = Byte & 0x1F;
+				NEST_PUSH(Stream->Size, 0);
 				EVENT(ARRAY);
-			case 0x98 ... 0x9B:
-				Stream->Size = Stream->Required = 1 << (Byte - 0x98);
-				Stream->State = MCS_ARRAY_SIZE;
-				break;
-			case 0x9F:
+			case MCA_ARRAY_INDEF:
 				Stream->Size = Stream->Required = SIZE_MAX;
+				NEST_PUSH(SIZE_MAX, 0);
 				EVENT(ARRAY);
-			case 0xA0 ... 0xB7:
-				Stream->Size = Stream->Required = Byte - 0xA0;
+			case MCA_MAP:
+				Stream->Size = Stream->Required = Byte & 0x1F;
+				NEST_PUSH(Stream->Size, 1);
 				EVENT(MAP);
-			case 0xB8 ... 0xBB:
-				Stream->Size = Stream->Required = 1 << (Byte - 0xB8);
-				Stream->State = MCS_MAP_SIZE;
-				break;
-			case 0xBF:
+			case MCA_MAP_INDEF:
 				Stream->Size = Stream->Required = SIZE_MAX;
+				NEST_PUSH(SIZE_MAX, 1);
 				EVENT(MAP);
-			case 0xC0 ... 0xD7:
-				Stream->Tag = Byte - 0xC0;
+			case MCA_TAG:
+				Stream->Tag = Byte & 0x1F;
 				EVENT(TAG);
-			case 0xD8 ... 0xDB:
-				Stream->Size = Stream->Required = 1 << (Byte - 0xD8);
-				Stream->State = MCS_TAG;
-				break;
-			case 0xE0 ... 0xF7:
-				Stream->Simple = Byte - 0xE0;
+			case MCA_SIMPLE:
+				Stream->Simple = Byte & 0x1F;
+				NEST_ITEM();
 				EVENT(SIMPLE);
-			case 0xF8:
-				Stream->State = MCS_SIMPLE;
-				break;
-			case 0xF9 ... 0xFB:
-				Stream->Size = Stream->Required = 1 << (Byte - 0xF8);
-				Stream->State = MCS_FLOAT;
-				break;
-			case 0xFF:
+			case MCA_BREAK:
+#ifdef MINICBOR_MAX_DEPTH
+				if (!MINICBOR(nest_break)(Stream->Stack, Stream->Depth)) {
+					Stream->State = MCS_INVALID;
+					EVENT(ERROR);
+				}
+				Stream->Available = Available;
+				Stream->Next = Next;
+				--Stream->Depth;
+				NEST_ITEM();
+				return MCE_END;
+#else
 				EVENT(BREAK);
+#endif
+			default: __builtin_unreachable();
 			}
 			break;
 		}
 		case MCS_POSITIVE: {
-			int Required = Stream->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Next++;
-				--Available;
-			}
-			if (!Required) {
-				uint64_t Integer = 0;
-				switch (Stream->Size) {
-				case 1: Integer = *(uint8_t *)Buffer; break;
-				case 2: Integer = *(uint16_t *)Buffer; break;
-				case 4: Integer = *(uint32_t *)Buffer; break;
-				case 8: Integer = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Integer;
+			if (READ_ARGUMENT(Integer)) {
 				Stream->State = MCS_DEFAULT;
 				Stream->Integer = Integer;
+				NEST_ITEM();
 				EVENT(POSITIVE);
-			} else {
-				Stream->Required = Required;
 			}
 			break;
 		}
 		case MCS_NEGATIVE: {
-			int Required = Stream->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Next++;
-				--Available;
-			}
-			if (!Required) {
-				uint64_t Integer = 0;
-				switch (Stream->Size) {
-				case 1: Integer = *(uint8_t *)Buffer; break;
-				case 2: Integer = *(uint16_t *)Buffer; break;
-				case 4: Integer = *(uint32_t *)Buffer; break;
-				case 8: Integer = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Integer;
+			if (READ_ARGUMENT(Integer)) {
 				Stream->State = MCS_DEFAULT;
 				Stream->Integer = Integer;
+				NEST_ITEM();
 				EVENT(NEGATIVE);
-			} else {
-				Stream->Required = Required;
 			}
 			break;
 		}
 		case MCS_BYTES_SIZE: {
-			int Required = Stream->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Next++;
-				--Available;
-			}
-			if (!Required) {
-				int Size = 0;
-				switch (Stream->Size) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				if (Size) {
 					Stream->Required = Size;
 					Stream->State = MCS_BYTES;
 				} else {
 					Stream->State = MCS_DEFAULT;
+					NEST_ITEM();
 				}
 				Stream->Size = Size;
 				EVENT(BYTES);
-			} else {
-				Stream->Required = Required;
 			}
 			break;
 		}
 		case MCS_BYTES: {
-			int Required = Stream->Required;
+			size_t Required = Stream->Required;
 			Stream->Bytes = Next;
 			if (Available < Required) {
 				Stream->Size = Available;
@@ -187,6 +237,7 @@ minicbor_event_t MINICBOR(next)(minicbor_stream_t *Stream) {
 				Next += Required;
 				Available -= Required;
 				Stream->State = MCS_DEFAULT;
+				NEST_ITEM();
 			}
 			EVENT(BYTES_PIECE);
 		}
@@ -199,12 +250,13 @@ minicbor_event_t MINICBOR(next)(minicbor_stream_t *Stream) {
 				Stream->State = MCS_BYTES_CHUNK;
 				break;
 			case 0x58 ... 0x5B:
-				Stream->Required = 1 << (Byte - 0x58);
+				Stream->Size = Stream->Required = 1 << (Byte - 0x58);
 				Stream->State = MCS_BYTES_CHUNK_SIZE;
 				break;
 			case 0xFF:
 				Stream->State = MCS_DEFAULT;
 				Stream->Size = Stream->Required = 0;
+				NEST_ITEM();
 				EVENT(BYTES_PIECE);
 			default:
 				Stream->State = MCS_INVALID;
@@ -213,29 +265,17 @@ minicbor_event_t MINICBOR(next)(minicbor_stream_t *Stream) {
 			break;
 		}
 		case MCS_BYTES_CHUNK_SIZE: {
-			int Required = Stream->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Next++;
-				--Available;
-			}
-			if (!Required) {
-				int Size = 0;
-				switch (Stream->Size) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				Stream->Required = Size;
 				Stream->State = MCS_BYTES_CHUNK;
-			} else {
-				Stream->Required = Required;
 			}
 			break;
 		}
 		case MCS_BYTES_CHUNK: {
-			int Required = Stream->Required;
+			size_t Required = Stream->Required;
+			Stream->Bytes = Next;
 			if (Available < Required) {
 				Stream->Size = Available;
 				Stream->Required = Required - Available;
@@ -251,47 +291,38 @@ minicbor_event_t MINICBOR(next)(minicbor_stream_t *Stream) {
 			EVENT(BYTES_PIECE);
 		}
 		case MCS_STRING_SIZE: {
-			int Required = Stream->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Next++;
-				--Available;
-			}
-			if (!Required) {
-				int Size = 0;
-				switch (Stream->Size) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				if (Size) {
 					Stream->Required = Size;
 					Stream->State = MCS_STRING;
 				} else {
 					Stream->State = MCS_DEFAULT;
+					NEST_ITEM();
 				}
 				Stream->Size = Size;
 				EVENT(STRING);
-			} else {
-				Stream->Required = Required;
 			}
 			break;
 		}
 		case MCS_STRING: {
-			int Required = Stream->Required;
+			size_t Required = Stream->Required;
 			Stream->Bytes = Next;
 			if (Available < Required) {
+				VALIDATE_UTF8(Available, 0);
 				Stream->Size = Available;
 				Stream->Required = Required - Available;
 				Next += Available;
 				Available = 0;
 			} else {
+				VALIDATE_UTF8(Required, 1);
 				Stream->Size = Required;
 				Stream->Required = 0;
 				Next += Required;
 				Available -= Required;
 				Stream->State = MCS_DEFAULT;
+				NEST_ITEM();
 			}
 			EVENT(STRING_PIECE);
 		}
@@ -304,12 +335,13 @@ minicbor_event_t MINICBOR(next)(minicbor_stream_t *Stream) {
 				Stream->State = MCS_STRING_CHUNK;
 				break;
 			case 0x78 ... 0x7B:
-				Stream->Required = 1 << (Byte - 0x78);
+				Stream->Size = Stream->Required = 1 << (Byte - 0x78);
 				Stream->State = MCS_STRING_CHUNK_SIZE;
 				break;
 			case 0xFF:
 				Stream->State = MCS_DEFAULT;
 				Stream->Size = Stream->Required = 0;
+				NEST_ITEM();
 				EVENT(STRING_PIECE);
 			default:
 				Stream->State = MCS_INVALID;
@@ -318,35 +350,25 @@ minicbor_event_t MINICBOR(next)(minicbor_stream_t *Stream) {
 			break;
 		}
 		case MCS_STRING_CHUNK_SIZE: {
-			int Required = Stream->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Next++;
-				--Available;
-			}
-			if (!Required) {
-				int Size = 0;
-				switch (Stream->Size) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				Stream->Required = Size;
 				Stream->State = MCS_STRING_CHUNK;
-			} else {
-				Stream->Required = Required;
 			}
 			break;
 		}
 		case MCS_STRING_CHUNK: {
-			int Required = Stream->Required;
+			size_t Required = Stream->Required;
+			Stream->Bytes = Next;
 			if (Available < Required) {
+				VALIDATE_UTF8(Available, 0);
 				Stream->Size = Available;
 				Stream->Required = Required - Available;
 				Next += Available;
 				Available = 0;
 			} else {
+				VALIDATE_UTF8(Required, 1);
 				Stream->Size = Required;
 				Stream->Required = SIZE_MAX;
 				Next += Required;
@@ -356,71 +378,33 @@ minicbor_event_t MINICBOR(next)(minicbor_stream_t *Stream) {
 			EVENT(STRING_PIECE);
 		}
 		case MCS_ARRAY_SIZE: {
-			int Required = Stream->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Next++;
-				--Available;
-			}
-			if (!Required) {
-				int Size = 0;
-				switch (Stream->Size) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				Stream->Size = Stream->Required = Size;
 				Stream->State = MCS_DEFAULT;
+				NEST_PUSH(Size, 0);
 				EVENT(ARRAY);
-			} else {
-				Stream->Required = Required;
 			}
 			break;
 		}
 		case MCS_MAP_SIZE: {
-			int Required = Stream->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Next++;
-				--Available;
-			}
-			if (!Required) {
-				int Size = 0;
-				switch (Stream->Size) {
-				case 1: Size = *(uint8_t *)Buffer; break;
-				case 2: Size = *(uint16_t *)Buffer; break;
-				case 4: Size = *(uint32_t *)Buffer; break;
-				case 8: Size = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Size;
+			if (READ_ARGUMENT(Size)) {
+				CHECK_SIZE(Size);
 				Stream->Size = Stream->Required = Size;
 				Stream->State = MCS_DEFAULT;
+				NEST_PUSH(Size, 1);
 				EVENT(MAP);
-			} else {
-				Stream->Required = Required;
 			}
 			break;
 		}
 		case MCS_TAG: {
-			int Required = Stream->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Next++;
-				--Available;
-			}
-			if (!Required) {
-				uint64_t Tag = 0;
-				switch (Stream->Size) {
-				case 1: Tag = *(uint8_t *)Buffer; break;
-				case 2: Tag = *(uint16_t *)Buffer; break;
-				case 4: Tag = *(uint32_t *)Buffer; break;
-				case 8: Tag = *(uint64_t *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Tag;
+			if (READ_ARGUMENT(Tag)) {
 				Stream->Tag = Tag;
 				Stream->State = MCS_DEFAULT;
 				EVENT(TAG);
-			} else {
-				Stream->Required = Required;
 			}
 			break;
 		}
@@ -429,40 +413,17 @@ minicbor_event_t MINICBOR(next)(minicbor_stream_t *Stream) {
 			--Available;
 			Stream->Simple = Value;
 			Stream->State = MCS_DEFAULT;
+			NEST_ITEM();
 			EVENT(SIMPLE);
 		}
 		case MCS_FLOAT: {
-			int Required = Stream->Required;
-			while (Available && Required) {
-				Buffer[--Required] = *Next++;
-				--Available;
-			}
-			if (!Required) {
-				double Real = 0;
-				switch (Stream->Size) {
-				case 2: {
-					int Half = (Buffer[1] << 8) + Buffer[0];
-					int Exp = (Half >> 10) & 0x1F;
-					int Mant = Half & 0x3FF;
-					if (Exp == 0) {
-						Real = ldexp(Mant, -24);
-					} else if (Exp != 31) {
-						Real = ldexp(Mant + 1024, Exp - 25);
-					} else {
-						Real = Mant ? NAN : INFINITY;
-					}
-					if (Half & 0x8000) Real = -Real;
-					break;
-				}
-				case 4: Real = *(float *)Buffer; break;
-				case 8: Real = *(double *)Buffer; break;
-				default: __builtin_unreachable();
-				}
+			uint64_t Bits;
+			if (READ_ARGUMENT(Bits)) {
+				double Real = MINICBOR(decode_float)(Stream->Size, Bits);
 				Stream->Real = Real;
 				Stream->State = MCS_DEFAULT;
+				NEST_ITEM();
 				EVENT(FLOAT);
-			} else {
-				Stream->Required = Required;
 			}
 			break;
 		}
@@ -0,0 +1,230 @@
+#include "minicbor_internal.h"
+#include "minicbor_tape.h"
+
+static const unsigned char MinicborTapeTypes[8] = {
+	MCE_POSITIVE, MCE_NEGATIVE, MCE_BYTES, MCE_STRING, MCE_ARRAY, MCE_MAP, MCE_TAG, MCE_SIMPLE
+};
+
+#define TAPE_ENTRY(TYPE, OFFSET, NEXT) (((uint64_t)(TYPE) << 60) | ((uint64_t)(OFFSET) << 28) | (NEXT))
+
+/*
+ * An open array, map or tag (a container of one item) while building a tape.
+ * Total is SIZE_MAX for indefinite containers, Block is the index of the key block for maps which have one (otherwise 0).
+ */
+typedef struct {
+	size_t Entry, Total, Items, Block;
+	size_t KeyOffset, LastOffset, LastLength;
+	int Map, Sorted;
+} minicbor_tape_frame_t;
+
+/*
+ * Compares the encoded key of Length bytes at Key with the encoding formed by Prefix followed by Rest,
+ * bytewise lexicographically with shorter encodings first on a common prefix.
+ */
+static int MINICBOR(tape_compare)(const unsigned char *Key, size_t Length, const unsigned char *Prefix, size_t PrefixLength, const unsigned char *Rest, size_t RestLength) {
+	size_t Common = Length < PrefixLength ? Length : PrefixLength;
+	int Result = memcmp(Key, Prefix, Common);
+	if (Result) return Result;
+	if (Length < PrefixLength) return -1;
+	Key += PrefixLength;
+	Length -= PrefixLength;
+	Common = Length < RestLength ? Length : RestLength;
+	Result = memcmp(Key, Rest, Common);
+	if (Result) return Result;
+	return (Length > RestLength) - (Length < RestLength);
+}
+
+/*
+ * Marks the key block of a completed map as unsorted if its keys were not in strictly increasing order.
+ */
+static void MINICBOR(tape_close)(minicbor_tape_frame_t *Frame, uint64_t *Tape, size_t Capacity) {
+	if (!Frame->Block || Frame->Sorted) return;
+	size_t Keys = Frame->Total / 2;
+	for (size_t Index = Frame->Block; Index < Frame->Block + Keys && Index < Capacity; ++Index) {
+		// MINICBOR_TAPE_KEYS has a subset of the bits of MINICBOR_TAPE_KEYS_UNSORTED
+		Tape[Index] |= TAPE_ENTRY(MINICBOR_TAPE_KEYS_UNSORTED, 0, 0);
+	}
+}
+
+size_t MINICBOR(tape_build)(const void *Data, size_t Size, uint64_t *Tape, size_t Capacity) {
+	const unsigned char *Bytes = (const unsigned char *)Data;
+	if (Size > MINICBOR_TAPE_MAX_OFFSET) return 0;
+	minicbor_tape_frame_t Stack[MINICBOR_TAPE_DEPTH];
+	int Depth = 0;
+	size_t Count = 0, Position = 0;
+	while (Position < Size) {
+		unsigned char Byte = Bytes[Position];
+		minicbor_tape_frame_t *Top = Depth ? Stack + Depth - 1 : NULL;
+		size_t Entry;
+		if (Byte == 0xFF) {
+			if (!Top || Top->Total != SIZE_MAX || (Top->Map && Top->Items % 2)) return 0;
+			++Position;
+			Entry = Top->Entry;
+			--Depth;
+			goto complete;
+		}
+		if (Top && Top->Map && !(Top->Items % 2)) {
+			Top->KeyOffset = Position;
+			size_t Key = Top->Block + Top->Items / 2;
+			if (Top->Block && Key < Capacity) Tape[Key] = TAPE_ENTRY(MINICBOR_TAPE_KEYS, Position, Count);
+		}
+		Entry = Count++;
+		minicbor_head_t Head = MinicborHeads[Byte];
+		unsigned char Type = MinicborTapeTypes[Byte >> 5];
+		uint64_t Argument = Byte & 0x1F;
+		size_t Start = Position++;
+		if (Head.Action == MCA_ARGUMENT) {
+			if (Size - Position < Head.Width) return 0;
+			Argument = MINICBOR(load_argument)(Bytes + Position, Head.Width, Size - Position);
+			Position += Head.Width;
+			if (Head.State == MCS_FLOAT) Type = MCE_FLOAT;
+			switch (Head.State) {
+			case MCS_BYTES_SIZE: Head.Action = MCA_BYTES; break;
+			case MCS_STRING_SIZE: Head.Action = MCA_STRING; break;
+			case MCS_ARRAY_SIZE: Head.Action = MCA_ARRAY; break;
+			case MCS_MAP_SIZE: Head.Action = MCA_MAP; break;
+			case MCS_TAG: Head.Action = MCA_TAG; break;
+			default: break;
+			}
+		}
+		if (Entry < Capacity) Tape[Entry] = TAPE_ENTRY(Type, Start, 0);
+		switch (Head.Action) {
+		case MCA_INVALID:
+		case MCA_BREAK:
+			return 0;
+		case MCA_BYTES:
+		case MCA_STRING:
+			if (Argument > Size - Position) return 0;
+			Position += Argument;
+			break;
+		case MCA_BYTES_INDEF:
+		case MCA_STRING_INDEF: {
+			minicbor_skip_t Skip;
+			MINICBOR(skip_start)(&Skip, Head.State, 0, 0, NULL, 1);
+			const unsigned char *Next = Bytes + Position;
+			size_t Available = Size - Position;
+			if (MINICBOR(skip_input)(&Skip, &Next, &Available) != 1) return 0;
+			Position = Next - Bytes;
+			break;
+		}
+		case MCA_ARRAY:
+		case MCA_ARRAY_INDEF:
+		case MCA_MAP:
+		case MCA_MAP_INDEF:
+		case MCA_TAG: {
+			if (Depth == MINICBOR_TAPE_DEPTH) return 0;
+			minicbor_tape_frame_t *Frame = Stack + Depth++;
+			Frame->Entry = Entry;
+			Frame->Items = 0;
+			Frame->Block = 0;
+			Frame->Sorted = 1;
+			Frame->Map = Head.Action == MCA_MAP || Head.Action == MCA_MAP_INDEF;
+			if (Head.Action == MCA_TAG) {
+				Frame->Total = 1;
+			} else if (Head.Action == MCA_ARRAY_INDEF || Head.Action == MCA_MAP_INDEF) {
+				Frame->Total = SIZE_MAX;
+			} else if (Argument > (Frame->Map ? (Size - Position) / 2 : Size - Position)) {
+				// Every item takes at least one byte
+				return 0;
+			} else if (Frame->Map) {
+				Frame->Total = 2 * Argument;
+				if (Argument >= MINICBOR_TAPE_MIN_KEYS) {
+					Frame->Block = Count;
+					Count += Argument;
+				}
+			} else {
+				Frame->Total = Argument;
+			}
+			if (Frame->Total) continue;
+			--Depth;
+			break;
+		}
+		default:
+			break;
+		}
+	complete:
+		// Link the completed item to its next sibling, then account for it in its parent
+		for (;;) {
+			if (Entry < Capacity && Count <= MINICBOR_TAPE_MAX_INDEX) Tape[Entry] |= Count;
+			if (!Depth) break;
+			minicbor_tape_frame_t *Parent = Stack + Depth - 1;
+			if (Parent->Map && !(Parent->Items % 2)) {
+				size_t Length = Position - Parent->KeyOffset;
+				if (Parent->Items && MINICBOR(tape_compare)(Bytes + Parent->LastOffset, Parent->LastLength, Bytes + Parent->KeyOffset, Length, Bytes + Position, 0) >= 0) {
+					Parent->Sorted = 0;
+				}
+				Parent->LastOffset = Parent->KeyOffset;
+				Parent->LastLength = Length;
+			}
+			if (++Parent->Items != Parent->Total) break;
+			MINICBOR(tape_close)(Parent, Tape, Capacity);
+			Entry = Parent->Entry;
+			--Depth;
+		}
+	}
+	if (Depth || Count > MINICBOR_TAPE_MAX_INDEX) return 0;
+	return Count;
+}
+
+size_t MINICBOR(tape_index)(const uint64_t *Tape, size_t Index, size_t Position) {
+	if (MINICBOR(tape_type)(Tape, Index) != MCE_ARRAY) return SIZE_MAX;
+	size_t End = MINICBOR(tape_next)(Tape, Index);
+	size_t Item = Index + 1;
+	while (Item < End) {
+		if (!Position--) return Item;
+		Item = MINICBOR(tape_next)(Tape, Item);
+	}
+	return SIZE_MAX;
+}
+
+/*
+ * Finds the value for the key encoded as Prefix followed by Rest in the map at Index.
+ */
+static size_t MINICBOR(tape_lookup)(const uint64_t *Tape, const unsigned char *Bytes, size_t Index, const unsigned char *Prefix, size_t PrefixLength, const unsigned char *Rest, size_t RestLength) {
+	if (MINICBOR(tape_type)(Tape, Index) != MCE_MAP) return SIZE_MAX;
+	size_t End = MINICBOR(tape_next)(Tape, Index);
+	size_t Block = Index + 1;
+	if (Block < End && MINICBOR(tape_type)(Tape, Block) == MINICBOR_TAPE_KEYS) {
+		// Binary search on the sorted key block, the value of each key starts where its encoding ends
+		size_t Low = 0, High = MINICBOR(tape_next)(Tape, Block) - Block;
+		while (Low < High) {
+			size_t Middle = Low + (High - Low) / 2;
+			size_t Offset = MINICBOR(tape_offset)(Tape, Block + Middle);
+			size_t Value = MINICBOR(tape_next)(Tape, MINICBOR(tape_next)(Tape, Block + Middle));
+			size_t Length = MINICBOR(tape_offset)(Tape, Value) - Offset;
+			int Result = MINICBOR(tape_compare)(Bytes + Offset, Length, Prefix, PrefixLength, Rest, RestLength);
+			if (!Result) return Value;
+			if (Result < 0) {
+				Low = Middle + 1;
+			} else {
+				High = Middle;
+			}
+		}
+		return SIZE_MAX;
+	}
+	size_t Key = MINICBOR(tape_child)(Tape, Index);
+	while (Key < End) {
+		size_t Value = MINICBOR(tape_next)(Tape, Key);
+		size_t Offset = MINICBOR(tape_offset)(Tape, Key);
+		size_t Length = MINICBOR(tape_offset)(Tape, Value) - Offset;
+		if (Length == PrefixLength + RestLength && !MINICBOR(tape_compare)(Bytes + Offset, Length, Prefix, PrefixLength, Rest, RestLength)) return Value;
+		Key = MINICBOR(tape_next)(Tape, Value);
+	}
+	return SIZE_MAX;
+}
+
+size_t MINICBOR(tape_find)(const uint64_t *Tape, const void *Bytes, size_t Index, const void *Key, size_t Size) {
+	return MINICBOR(tape_lookup)(Tape, Bytes, Index, Key, Size, (const unsigned char *)Key + Size, 0);
+}
+
+size_t MINICBOR(tape_get)(const uint64_t *Tape, const void *Bytes, size_t Index, const char *Key, size_t Length) {
+	unsigned char Head[9];
+	size_t HeadLength = MINICBOR(encode_head)(Head, 3, Length);
+	return MINICBOR(tape_lookup)(Tape, Bytes, Index, Head, HeadLength, (const unsigned char *)Key, Length);
+}
+
+size_t MINICBOR(tape_get_integer)(const uint64_t *Tape, const void *Bytes, size_t Index, int64_t Key) {
+	unsigned char Head[9];
+	size_t HeadLength = Key < 0 ? MINICBOR(encode_head)(Head, 1, -1 - (uint64_t)Key) : MINICBOR(encode_head)(Head, 0, Key);
+	return MINICBOR(tape_lookup)(Tape, Bytes, Index, Head, HeadLength, Head + HeadLength, 0);
+}
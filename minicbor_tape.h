@@ -0,0 +1,101 @@
+#ifndef MINICBOR_TAPE_H
+#define MINICBOR_TAPE_H
+
+#include "minicbor_view.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A tape is a structural index of a complete CBOR buffer, with one 64-bit entry per data item in document order.
+ * Each entry holds the item's type (bits 60-63), the offset of its initial byte in the buffer (bits 28-59)
+ * and the tape index just past its subtree, i.e. of its next sibling (bits 0-27).
+ * Documents are limited to :c:macro:`MINICBOR_TAPE_MAX_OFFSET` bytes and :c:macro:`MINICBOR_TAPE_MAX_INDEX` entries.
+ *
+ * Item types are the corresponding :c:type:`minicbor_event_t` values (:code:`MCE_POSITIVE` to :code:`MCE_FLOAT`).
+ * A tag's entry is followed by the tagged item's entry, indefinite bytestrings and strings have a single entry.
+ * Definite maps with at least :c:macro:`MINICBOR_TAPE_MIN_KEYS` keys are followed by a block of key entries (before the first key),
+ * one per key in order, each holding the key's offset and tape index, typed :c:macro:`MINICBOR_TAPE_KEYS` if the keys are sorted
+ * (bytewise lexicographically by their encodings, as in deterministic CBOR) or :c:macro:`MINICBOR_TAPE_KEYS_UNSORTED` otherwise.
+ */
+
+#define MINICBOR_TAPE_KEYS 14
+#define MINICBOR_TAPE_KEYS_UNSORTED 15
+
+#define MINICBOR_TAPE_MAX_OFFSET 0xFFFFFFFF
+#define MINICBOR_TAPE_MAX_INDEX 0xFFFFFFF
+
+#ifndef MINICBOR_TAPE_MIN_KEYS
+#define MINICBOR_TAPE_MIN_KEYS 8
+#endif
+
+#ifndef MINICBOR_TAPE_DEPTH
+#define MINICBOR_TAPE_DEPTH 64
+#endif
+
+static inline unsigned MINICBOR(tape_type)(const uint64_t *Tape, size_t Index) {
+	return Tape[Index] >> 60;
+}
+
+static inline size_t MINICBOR(tape_offset)(const uint64_t *Tape, size_t Index) {
+	return (Tape[Index] >> 28) & MINICBOR_TAPE_MAX_OFFSET;
+}
+
+static inline size_t MINICBOR(tape_next)(const uint64_t *Tape, size_t Index) {
+	return Tape[Index] & MINICBOR_TAPE_MAX_INDEX;
+}
+
+/**
+ * Builds the tape for the CBOR sequence in :code:`Bytes` into :code:`Tape` in a single pass.
+ * Returns the number of entries required, which may be more than :code:`Capacity` in which case only the first :code:`Capacity` entries are written and the tape must be rebuilt with enough space.
+ * Returns 0 if the input is empty, malformed, nested deeper than :c:macro:`MINICBOR_TAPE_DEPTH` or too large for the tape format.
+ */
+size_t MINICBOR(tape_build)(const void *Bytes, size_t Size, uint64_t *Tape, size_t Capacity);
+
+/**
+ * Returns the index of the first item in the array, map (skipping any key block) or tag at :code:`Index`.
+ * The items of a container can then be visited with :code:`for (size_t I = minicbor_tape_child(Tape, Index); I < minicbor_tape_next(Tape, Index); I = minicbor_tape_next(Tape, I))`.
+ */
+static inline size_t MINICBOR(tape_child)(const uint64_t *Tape, size_t Index) {
+	size_t Child = Index + 1;
+	if (Child < MINICBOR(tape_next)(Tape, Index) && MINICBOR(tape_type)(Tape, Child) >= MINICBOR_TAPE_KEYS) {
+		Child = MINICBOR(tape_next)(Tape, Child);
+	}
+	return Child;
+}
+
+/**
+ * Returns the index of item :code:`Position` in the array at :code:`Index`, or :code:`SIZE_MAX` if there is no such item.
+ */
+size_t MINICBOR(tape_index)(const uint64_t *Tape, size_t Index, size_t Position);
+
+/**
+ * Returns the index of the value for the key whose encoding is :code:`Key` in the map at :code:`Index`, or :code:`SIZE_MAX` if there is no such key.
+ * Uses a binary search if the map has a sorted key block, otherwise compares each key in turn.
+ */
+size_t MINICBOR(tape_find)(const uint64_t *Tape, const void *Bytes, size_t Index, const void *Key, size_t Size);
+
+/**
+ * Equivalent to :c:func:`minicbor_tape_find()` with the encoding of the text string :code:`Key` of :code:`Length` bytes.
+ */
+size_t MINICBOR(tape_get)(const uint64_t *Tape, const void *Bytes, size_t Index, const char *Key, size_t Length);
+
+/**
+ * Equivalent to :c:func:`minicbor_tape_find()` with the encoding of the integer :code:`Key`.
+ */
+size_t MINICBOR(tape_get_integer)(const uint64_t *Tape, const void *Bytes, size_t Index, int64_t Key);
+
+/**
+ * Returns a view of the item at :code:`Index` for use with the typed getters in :file:`minicbor_view.h`.
+ */
+static inline minicbor_view_t MINICBOR(tape_view)(const uint64_t *Tape, const void *Bytes, size_t Size, size_t Index) {
+	minicbor_view_t View = {(const unsigned char *)Bytes + MINICBOR(tape_offset)(Tape, Index), (const unsigned char *)Bytes + Size};
+	return View;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,418 @@
+#include "minicbor_internal.h"
+#include "minicbor_view.h"
+
+static const minicbor_event_t MinicborViewTypes[8] = {
+	MCE_POSITIVE, MCE_NEGATIVE, MCE_BYTES, MCE_STRING, MCE_ARRAY, MCE_MAP, MCE_TAG, MCE_SIMPLE
+};
+
+/*
+ * Decodes the head of View, storing its argument (SIZE_MAX for indefinite items) and the position after the head.
+ */
+static minicbor_event_t MINICBOR(view_head)(minicbor_view_t View, uint64_t *Argument, const unsigned char **After) {
+	const unsigned char *Next = View.Head;
+	if (!Next || Next >= View.Limit) return MCE_ERROR;
+	unsigned char Byte = *Next++;
+	minicbor_head_t Head = MinicborHeads[Byte];
+	switch (Head.Action) {
+	case MCA_INVALID:
+	case MCA_BREAK:
+		return MCE_ERROR;
+	case MCA_ARGUMENT:
+		if (View.Limit - Next < Head.Width) return MCE_ERROR;
+		*Argument = MINICBOR(load_argument)(Next, Head.Width, View.Limit - Next);
+		*After = Next + Head.Width;
+		if (Head.State == MCS_FLOAT) return MCE_FLOAT;
+		break;
+	case MCA_BYTES_INDEF:
+	case MCA_STRING_INDEF:
+	case MCA_ARRAY_INDEF:
+	case MCA_MAP_INDEF:
+		*Argument = SIZE_MAX;
+		*After = Next;
+		break;
+	default:
+		*Argument = Byte & 0x1F;
+		*After = Next;
+		break;
+	}
+	return MinicborViewTypes[Byte >> 5];
+}
+
+/*
+ * Returns the position after the item in View, or NULL if it is invalid or truncated.
+ */
+static const unsigned char *MINICBOR(view_end)(minicbor_view_t View) {
+	if (!View.Head || View.Head >= View.Limit) return NULL;
+	minicbor_skip_t Skip;
+	MINICBOR(skip_start)(&Skip, MCS_DEFAULT, 0, 0, NULL, 1);
+	const unsigned char *Next = View.Head;
+	size_t Available = View.Limit - Next;
+	if (MINICBOR(skip_input)(&Skip, &Next, &Available) != 1) return NULL;
+	return Next;
+}
+
+minicbor_event_t MINICBOR(view_type)(minicbor_view_t View) {
+	uint64_t Argument;
+	const unsigned char *After;
+	return MINICBOR(view_head)(View, &Argument, &After);
+}
+
+size_t MINICBOR(view_size)(minicbor_view_t View) {
+	uint64_t Argument;
+	const unsigned char *After;
+	switch (MINICBOR(view_head)(View, &Argument, &After)) {
+	case MCE_BYTES:
+	case MCE_STRING:
+	case MCE_ARRAY:
+	case MCE_MAP:
+		return Argument < SIZE_MAX ? Argument : SIZE_MAX;
+	default:
+		return 0;
+	}
+}
+
+minicbor_view_t MINICBOR(view_after)(minicbor_view_t View) {
+	const unsigned char *Next = MINICBOR(view_end)(View);
+	minicbor_view_t After = {Next && Next < View.Limit ? Next : NULL, View.Limit};
+	return After;
+}
+
+int MINICBOR(view_encoded)(minicbor_view_t View, const unsigned char **Bytes, size_t *Size) {
+	const unsigned char *Next = MINICBOR(view_end)(View);
+	if (!Next) return 0;
+	*Bytes = View.Head;
+	*Size = Next - View.Head;
+	return 1;
+}
+
+minicbor_view_t MINICBOR(view_index)(minicbor_view_t View, size_t Index) {
+	minicbor_view_t Item = {NULL, View.Limit};
+	uint64_t Size;
+	const unsigned char *Next;
+	if (MINICBOR(view_head)(View, &Size, &Next) != MCE_ARRAY) return Item;
+	if (Size != SIZE_MAX && Index >= Size) return Item;
+	if (Index) {
+		minicbor_skip_t Skip;
+		MINICBOR(skip_start)(&Skip, MCS_DEFAULT, 0, 0, NULL, Index);
+		size_t Available = View.Limit - Next;
+		// An indefinite array which is too short fails here on its break
+		if (MINICBOR(skip_input)(&Skip, &Next, &Available) != 1) return Item;
+	}
+	if (Next < View.Limit && *Next != 0xFF) Item.Head = Next;
+	return Item;
+}
+
+minicbor_view_t MINICBOR(view_get)(minicbor_view_t View, const char *Key, size_t Length) {
+	minicbor_view_iter_t Iter;
+	minicbor_view_t Value = {NULL, View.Limit};
+	if (MINICBOR(view_type)(View) != MCE_MAP || !MINICBOR(view_iter)(View, &Iter)) return Value;
+	while (MINICBOR(view_next)(&Iter)) {
+		uint64_t Size;
+		const unsigned char *Bytes;
+		int Match = MINICBOR(view_head)(Iter.Item, &Size, &Bytes) == MCE_STRING && Size == Length && !memcmp(Bytes, Key, Length);
+		if (!MINICBOR(view_next)(&Iter)) break;
+		if (Match) return Iter.Item;
+	}
+	return Value;
+}
+
+minicbor_view_t MINICBOR(view_get_integer)(minicbor_view_t View, int64_t Key) {
+	minicbor_view_iter_t Iter;
+	minicbor_view_t Value = {NULL, View.Limit};
+	if (MINICBOR(view_type)(View) != MCE_MAP || !MINICBOR(view_iter)(View, &Iter)) return Value;
+	minicbor_event_t Type = Key < 0 ? MCE_NEGATIVE : MCE_POSITIVE;
+	uint64_t Number = Key < 0 ? -1 - (uint64_t)Key : (uint64_t)Key;
+	while (MINICBOR(view_next)(&Iter)) {
+		uint64_t Argument;
+		const unsigned char *After;
+		int Match = MINICBOR(view_head)(Iter.Item, &Argument, &After) == Type && Argument == Number;
+		if (!MINICBOR(view_next)(&Iter)) break;
+		if (Match) return Iter.Item;
+	}
+	return Value;
+}
+
+minicbor_view_t MINICBOR(view_untag)(minicbor_view_t View, uint64_t *Tag) {
+	uint64_t Argument;
+	const unsigned char *After;
+	if (MINICBOR(view_head)(View, &Argument, &After) != MCE_TAG) return View;
+	if (Tag) *Tag = Argument;
+	minicbor_view_t Item = {After < View.Limit ? After : NULL, View.Limit};
+	return Item;
+}
+
+int MINICBOR(view_positive)(minicbor_view_t View, uint64_t *Value) {
+	const unsigned char *After;
+	return MINICBOR(view_head)(View, Value, &After) == MCE_POSITIVE;
+}
+
+int MINICBOR(view_integer)(minicbor_view_t View, int64_t *Value) {
+	uint64_t Argument;
+	const unsigned char *After;
+	switch (MINICBOR(view_head)(View, &Argument, &After)) {
+	case MCE_POSITIVE:
+		if (Argument > INT64_MAX) return 0;
+		*Value = Argument;
+		return 1;
+	case MCE_NEGATIVE:
+		if (Argument > INT64_MAX) return 0;
+		*Value = -1 - (int64_t)Argument;
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+int MINICBOR(view_float)(minicbor_view_t View, double *Value) {
+	uint64_t Bits;
+	const unsigned char *After;
+	if (MINICBOR(view_head)(View, &Bits, &After) != MCE_FLOAT) return 0;
+	*Value = MINICBOR(decode_float)(After - View.Head - 1, Bits);
+	return 1;
+}
+
+int MINICBOR(view_simple)(minicbor_view_t View, int *Value) {
+	uint64_t Argument;
+	const unsigned char *After;
+	if (MINICBOR(view_head)(View, &Argument, &After) != MCE_SIMPLE) return 0;
+	*Value = Argument;
+	return 1;
+}
+
+int MINICBOR(view_bytes)(minicbor_view_t View, const unsigned char **Bytes, size_t *Size) {
+	uint64_t Argument;
+	const unsigned char *After;
+	if (MINICBOR(view_head)(View, &Argument, &After) != MCE_BYTES) return 0;
+	if (Argument == SIZE_MAX || Argument > (uint64_t)(View.Limit - After)) return 0;
+	*Bytes = After;
+	*Size = Argument;
+	return 1;
+}
+
+int MINICBOR(view_string)(minicbor_view_t View, const char **String, size_t *Length) {
+	uint64_t Argument;
+	const unsigned char *After;
+	if (MINICBOR(view_head)(View, &Argument, &After) != MCE_STRING) return 0;
+	if (Argument == SIZE_MAX || Argument > (uint64_t)(View.Limit - After)) return 0;
+	*String = (const char *)After;
+	*Length = Argument;
+	return 1;
+}
+
+/*
+ * Target types for bulk numeric decoding.
+ */
+enum {
+	MVN_DOUBLE,
+	MVN_FLOAT,
+	MVN_INT64,
+	MVN_UINT32
+};
+
+/*
+ * Stores element Index of a bulk decode, returning 0 if the value cannot be represented in Target.
+ */
+static inline int MINICBOR(view_store_positive)(int Target, void *Values, size_t Index, uint64_t Number) {
+	switch (Target) {
+	case MVN_DOUBLE: ((double *)Values)[Index] = Number; return 1;
+	case MVN_FLOAT: ((float *)Values)[Index] = Number; return 1;
+	case MVN_INT64:
+		if (Number > INT64_MAX) return 0;
+		((int64_t *)Values)[Index] = Number;
+		return 1;
+	case MVN_UINT32:
+		if (Number > UINT32_MAX) return 0;
+		((uint32_t *)Values)[Index] = Number;
+		return 1;
+	default: __builtin_unreachable();
+	}
+}
+
+/*
+ * As MINICBOR(view_store_positive)() for the negative integer -1 - Number.
+ */
+static inline int MINICBOR(view_store_negative)(int Target, void *Values, size_t Index, uint64_t Number) {
+	switch (Target) {
+	case MVN_DOUBLE:
+		((double *)Values)[Index] = Number <= INT64_MAX ? (double)(-1 - (int64_t)Number) : -1.0 - (double)Number;
+		return 1;
+	case MVN_FLOAT:
+		((float *)Values)[Index] = Number <= INT64_MAX ? (float)(-1 - (int64_t)Number) : -1.0f - (float)Number;
+		return 1;
+	case MVN_INT64:
+		if (Number > INT64_MAX) return 0;
+		((int64_t *)Values)[Index] = -1 - (int64_t)Number;
+		return 1;
+	case MVN_UINT32: return 0;
+	default: __builtin_unreachable();
+	}
+}
+
+static inline int MINICBOR(view_store_float)(int Target, void *Values, size_t Index, double Number) {
+	switch (Target) {
+	case MVN_DOUBLE: ((double *)Values)[Index] = Number; return 1;
+	case MVN_FLOAT: ((float *)Values)[Index] = Number; return 1;
+	default: return 0;
+	}
+}
+
+/*
+ * Loads a typed array element of Width bytes, byte swapping big-endian elements to host order.
+ */
+static inline uint64_t MINICBOR(view_element)(const unsigned char *Bytes, size_t Width, int Little) {
+	switch (Width) {
+	case 1: return Bytes[0];
+	case 2: { uint16_t Word; memcpy(&Word, Bytes, 2); return Little ? Word : __builtin_bswap16(Word); }
+	case 4: { uint32_t Word; memcpy(&Word, Bytes, 4); return Little ? Word : __builtin_bswap32(Word); }
+	case 8: { uint64_t Word; memcpy(&Word, Bytes, 8); return Little ? Word : __builtin_bswap64(Word); }
+	default: __builtin_unreachable();
+	}
+}
+
+/*
+ * Decodes the elements of a typed array with tag Tag (64 to 87) over Size bytes.
+ * The tag is 0b010FSELL: F selects floats, S signed integers, E little-endian and LL the element width.
+ */
+static size_t MINICBOR(view_typed)(int Target, void *Values, size_t Count, uint64_t Tag, const unsigned char *Bytes, size_t Size) {
+	int Float = Tag & 0x10, Signed = Tag & 0x08, Little = Tag & 0x04;
+	size_t Width;
+	if (Float) {
+		// Tags 83 and 87 are 128-bit floats
+		if ((Tag & 3) == 3) return SIZE_MAX;
+		Width = 2 << (Tag & 3);
+	} else {
+		// Tag 76 is reserved, tag 68 is clamped unsigned bytes which decode the same as tag 64
+		if (Tag == 76) return SIZE_MAX;
+		Width = 1 << (Tag & 3);
+	}
+	if (Size % Width) return SIZE_MAX;
+	size_t Total = Size / Width;
+	if (Count < Total) return Total;
+	if (Float && Width == 2 && Target == MVN_DOUBLE) {
+		MINICBOR(halves_to_doubles)(Values, Bytes, Total, Little);
+		return Total;
+	}
+	int Shift = 64 - 8 * Width;
+	for (size_t Index = 0; Index < Total; ++Index, Bytes += Width) {
+		uint64_t Bits = MINICBOR(view_element)(Bytes, Width, Little);
+		int Stored;
+		if (Float) {
+			Stored = MINICBOR(view_store_float)(Target, Values, Index, MINICBOR(decode_float)(Width, Bits));
+		} else if (Signed && (int64_t)(Bits << Shift) < 0) {
+			// Sign extend, then -1 - Value is the complement
+			Stored = MINICBOR(view_store_negative)(Target, Values, Index, ~((int64_t)(Bits << Shift) >> Shift));
+		} else {
+			Stored = MINICBOR(view_store_positive)(Target, Values, Index, Bits);
+		}
+		if (!Stored) return SIZE_MAX;
+	}
+	return Total;
+}
+
+static size_t MINICBOR(view_numbers)(minicbor_view_t View, int Target, void *Values, size_t Count) {
+	uint64_t Argument;
+	const unsigned char *Next;
+	switch (MINICBOR(view_head)(View, &Argument, &Next)) {
+	case MCE_TAG: {
+		const unsigned char *Bytes;
+		size_t Size;
+		if (Argument < 64 || Argument > 87) return SIZE_MAX;
+		minicbor_view_t Item = {Next < View.Limit ? Next : NULL, View.Limit};
+		if (!MINICBOR(view_bytes)(Item, &Bytes, &Size)) return SIZE_MAX;
+		return MINICBOR(view_typed)(Target, Values, Count, Argument, Bytes, Size);
+	}
+	case MCE_ARRAY:
+		if (Argument == SIZE_MAX) return SIZE_MAX;
+		break;
+	default:
+		return SIZE_MAX;
+	}
+	size_t Total = Argument;
+	if (Count < Total) return Total;
+	const unsigned char *Limit = View.Limit;
+	size_t Index = 0;
+	while (Index < Total) {
+		if (Next == Limit) return SIZE_MAX;
+		unsigned char Byte = *Next;
+		minicbor_head_t Head = MinicborHeads[Byte];
+		size_t Width = Head.Action == MCA_ARGUMENT ? Head.Width : 0;
+		switch (Byte >> 5) {
+		case 0: case 1: break;
+		case 7: if (Head.State == MCS_FLOAT && Width) break;
+		// fallthrough
+		default: return SIZE_MAX;
+		}
+		// Decode the run of elements sharing this initial byte
+		do {
+			++Next;
+			if (Limit - Next < Width) return SIZE_MAX;
+			uint64_t Number = Width ? MINICBOR(load_argument)(Next, Width, Limit - Next) : Byte & 0x1F;
+			Next += Width;
+			int Stored;
+			switch (Byte >> 5) {
+			case 0: Stored = MINICBOR(view_store_positive)(Target, Values, Index, Number); break;
+			case 1: Stored = MINICBOR(view_store_negative)(Target, Values, Index, Number); break;
+			default: Stored = MINICBOR(view_store_float)(Target, Values, Index, MINICBOR(decode_float)(Width, Number)); break;
+			}
+			if (!Stored) return SIZE_MAX;
+		} while (++Index < Total && Next < Limit && *Next == Byte);
+	}
+	return Total;
+}
+
+size_t MINICBOR(view_doubles)(minicbor_view_t View, double *Values, size_t Count) {
+	return MINICBOR(view_numbers)(View, MVN_DOUBLE, Values, Count);
+}
+
+size_t MINICBOR(view_floats)(minicbor_view_t View, float *Values, size_t Count) {
+	return MINICBOR(view_numbers)(View, MVN_FLOAT, Values, Count);
+}
+
+size_t MINICBOR(view_int64s)(minicbor_view_t View, int64_t *Values, size_t Count) {
+	return MINICBOR(view_numbers)(View, MVN_INT64, Values, Count);
+}
+
+size_t MINICBOR(view_uint32s)(minicbor_view_t View, uint32_t *Values, size_t Count) {
+	return MINICBOR(view_numbers)(View, MVN_UINT32, Values, Count);
+}
+
+int MINICBOR(view_iter)(minicbor_view_t View, minicbor_view_iter_t *Iter) {
+	uint64_t Size;
+	const unsigned char *After;
+	Iter->Item.Head = NULL;
+	Iter->Item.Limit = View.Limit;
+	Iter->Remaining = 0;
+	switch (MINICBOR(view_head)(View, &Size, &After)) {
+	case MCE_ARRAY:
+		Iter->Remaining = Size;
+		break;
+	case MCE_MAP:
+		Iter->Remaining = Size == SIZE_MAX ? SIZE_MAX : Size < SIZE_MAX / 2 ? 2 * Size : SIZE_MAX - 1;
+		break;
+	case MCE_BYTES:
+	case MCE_STRING:
+		if (Size != SIZE_MAX) return 0;
+		Iter->Remaining = SIZE_MAX;
+		break;
+	default:
+		return 0;
+	}
+	Iter->Next = After;
+	return 1;
+}
+
+int MINICBOR(view_next)(minicbor_view_iter_t *Iter) {
+	if (!Iter->Remaining) goto done;
+	if (Iter->Remaining != SIZE_MAX) {
+		--Iter->Remaining;
+	} else if (Iter->Next < Iter->Item.Limit && *Iter->Next == 0xFF) {
+		// End of an indefinite array or map
+		goto done;
+	}
+	Iter->Item.Head = Iter->Next;
+	if ((Iter->Next = MINICBOR(view_end)(Iter->Item))) return 1;
+done:
+	Iter->Item.Head = NULL;
+	Iter->Remaining = 0;
+	return 0;
+}
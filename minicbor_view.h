@@ -0,0 +1,129 @@
+#ifndef MINICBOR_VIEW_H
+#define MINICBOR_VIEW_H
+
+#include "minicbor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A read-only cursor on a data item within a complete CBOR buffer (e.g. a memory-mapped file).
+ * Items are only decoded when accessed, views never allocate memory and can be freely copied.
+ * A view with :code:`Head` set to :code:`NULL` is invalid, i.e. a missing key or index, a type mismatch or malformed input.
+ */
+typedef struct {
+	const unsigned char *Head, *Limit;
+} minicbor_view_t;
+
+/**
+ * An iterator over the items of an array or map (alternating keys and values for maps) or the chunks of an indefinite bytestring or string.
+ */
+typedef struct {
+	minicbor_view_t Item;
+	const unsigned char *Next;
+	size_t Remaining;
+} minicbor_view_iter_t;
+
+/**
+ * Returns a view of the first data item in :code:`Bytes`.
+ * The buffer must remain valid while any view into it is in use.
+ */
+static inline minicbor_view_t MINICBOR(view)(const void *Bytes, size_t Size) {
+	minicbor_view_t View = {Size ? (const unsigned char *)Bytes : NULL, (const unsigned char *)Bytes + Size};
+	return View;
+}
+
+/**
+ * Returns 1 if :code:`View` refers to a data item.
+ */
+static inline int MINICBOR(view_valid)(minicbor_view_t View) {
+	return View.Head != NULL;
+}
+
+/**
+ * Returns the type of :code:`View` as the corresponding :c:type:`minicbor_event_t` (:code:`MCE_POSITIVE`, :code:`MCE_NEGATIVE`, :code:`MCE_BYTES`, :code:`MCE_STRING`, :code:`MCE_ARRAY`, :code:`MCE_MAP`, :code:`MCE_TAG`, :code:`MCE_SIMPLE` or :code:`MCE_FLOAT`),
+ * or :code:`MCE_ERROR` if :code:`View` is invalid.
+ */
+minicbor_event_t MINICBOR(view_type)(minicbor_view_t View);
+
+/**
+ * Returns the number of items in an array, the number of key-value pairs in a map or the length of a bytestring or string,
+ * :code:`SIZE_MAX` if it is indefinite or :code:`0` if :code:`View` is some other type.
+ */
+size_t MINICBOR(view_size)(minicbor_view_t View);
+
+/**
+ * Returns a view of the item following :code:`View`, skipping over :code:`View` entirely, or an invalid view if there is no following item.
+ */
+minicbor_view_t MINICBOR(view_after)(minicbor_view_t View);
+
+/**
+ * Sets :code:`Bytes` and :code:`Size` to the encoded bytes of :code:`View` (including all nested items) and returns 1, or returns 0 if :code:`View` is invalid.
+ */
+int MINICBOR(view_encoded)(minicbor_view_t View, const unsigned char **Bytes, size_t *Size);
+
+/**
+ * Returns a view of the item at :code:`Index` in an array, or an invalid view if :code:`View` is not an array or is too short.
+ * Preceding items are skipped without being decoded, so this takes time linear in the encoded size of the preceding items.
+ */
+minicbor_view_t MINICBOR(view_index)(minicbor_view_t View, size_t Index);
+
+/**
+ * Returns a view of the value for the text string key :code:`Key` of :code:`Length` bytes in a map, or an invalid view if :code:`View` is not a map or the key is not present.
+ * Keys which are indefinite strings are not matched.
+ */
+minicbor_view_t MINICBOR(view_get)(minicbor_view_t View, const char *Key, size_t Length);
+
+/**
+ * Returns a view of the value for the integer key :code:`Key` in a map, or an invalid view if :code:`View` is not a map or the key is not present.
+ */
+minicbor_view_t MINICBOR(view_get_integer)(minicbor_view_t View, int64_t Key);
+
+/**
+ * Returns a view of the tagged item if :code:`View` is a tag (storing the tag in :code:`Tag` if not :code:`NULL`), otherwise returns :code:`View` unchanged.
+ */
+minicbor_view_t MINICBOR(view_untag)(minicbor_view_t View, uint64_t *Tag);
+
+/**
+ * Typed getters: each stores the value of :code:`View` and returns 1 if :code:`View` has the corresponding type, otherwise returns 0.
+ * :c:func:`minicbor_view_integer()` accepts positive and negative integers which fit in an :code:`int64_t`,
+ * :c:func:`minicbor_view_bytes()` and :c:func:`minicbor_view_string()` only accept definite bytestrings and strings and return a pointer into the buffer.
+ */
+int MINICBOR(view_positive)(minicbor_view_t View, uint64_t *Value);
+int MINICBOR(view_integer)(minicbor_view_t View, int64_t *Value);
+int MINICBOR(view_float)(minicbor_view_t View, double *Value);
+int MINICBOR(view_simple)(minicbor_view_t View, int *Value);
+int MINICBOR(view_bytes)(minicbor_view_t View, const unsigned char **Bytes, size_t *Size);
+int MINICBOR(view_string)(minicbor_view_t View, const char **String, size_t *Length);
+
+/**
+ * Bulk numeric decoding: each decodes the elements of :code:`View` into :code:`Values` and returns the number of elements,
+ * where :code:`View` is either an RFC 8746 typed array (tags 64 to 87 over a definite bytestring, except the 128-bit floats) or a definite array of integers and floats.
+ * Runs of array elements with the same initial byte are decoded with a fixed stride.
+ * If :code:`Count` is less than the number of elements then nothing is decoded, so a :code:`Count` of 0 returns the number of elements required.
+ * Returns :code:`SIZE_MAX` if :code:`View` is neither or an element cannot be converted (in which case :code:`Values` may have been partially written).
+ * :c:func:`minicbor_view_doubles()` and :c:func:`minicbor_view_floats()` convert integers and floats as a C cast would,
+ * :c:func:`minicbor_view_int64s()` and :c:func:`minicbor_view_uint32s()` only accept integers within the range of their type.
+ */
+size_t MINICBOR(view_doubles)(minicbor_view_t View, double *Values, size_t Count);
+size_t MINICBOR(view_floats)(minicbor_view_t View, float *Values, size_t Count);
+size_t MINICBOR(view_int64s)(minicbor_view_t View, int64_t *Values, size_t Count);
+size_t MINICBOR(view_uint32s)(minicbor_view_t View, uint32_t *Values, size_t Count);
+
+/**
+ * Starts iterating over the items of an array or map (or the chunks of an indefinite bytestring or string), returning 0 if :code:`View` is none of these.
+ * Each call to :c:func:`minicbor_view_next()` then moves :code:`Iter->Item` to the next item.
+ */
+int MINICBOR(view_iter)(minicbor_view_t View, minicbor_view_iter_t *Iter);
+
+/**
+ * Moves :code:`Iter->Item` to the next item, returning 0 once there are no more items (or if the input is malformed).
+ */
+int MINICBOR(view_next)(minicbor_view_iter_t *Iter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
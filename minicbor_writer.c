@@ -1,5 +1,4 @@
 #include "minicbor.h"
-#include <math.h>
 
 #ifdef MINICBOR_WRITE_FN
 
@@ -10,6 +9,7 @@ static inline int MINICBOR(write)(MINICBOR_WRITE_PARAMS, const void *Bytes, size
 }
 
 #define MINICBOR_WRITE_ARGS UserData
+#define MINICBOR_BUFFER_ARGS(WRITER) (WRITER)->UserData
 
 #else
 
@@ -18,55 +18,37 @@ static inline int MINICBOR(write)(MINICBOR_WRITE_PARAMS, const void *Bytes, size
 }
 
 #define MINICBOR_WRITE_ARGS UserData, WriteFn
+#define MINICBOR_BUFFER_ARGS(WRITER) (WRITER)->UserData, (WRITER)->WriteFn
 
 #endif
 
-static int MINICBOR(write_number)(MINICBOR_WRITE_PARAMS, uint64_t Absolute, unsigned char Base) {
+static int MINICBOR(write_number)(MINICBOR_WRITE_PARAMS, uint64_t Absolute, unsigned char Major) {
 #ifdef MINICBOR_WRITE_BUFFER
 	unsigned char *Bytes = MINICBOR_WRITE_BUFFER(UserData);
 #else
 	unsigned char Bytes[9];
 #endif
-	if (Absolute < 24) {
-		Bytes[0] = Base + Absolute;
-		return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, 1);
-	} else if (Absolute <= 0xFF) {
-		Bytes[0] = Base + 0x18;
-		Bytes[1] = Absolute;
-		return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, 2);
-	} else if (Absolute <= 0xFFFF) {
-		Bytes[0] = Base + 0x19;
-		*(uint16_t *)(Bytes + 1) = __builtin_bswap16(Absolute);
-		return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, 3);
-	} else if (Absolute <= 0xFFFFFFFF){
-		Bytes[0] = Base + 0x1A;
-		*(uint32_t *)(Bytes + 1) = __builtin_bswap32(Absolute);
-		return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, 5);
-	} else {
-		Bytes[0] = Base + 0x1B;
-		*(uint64_t *)(Bytes + 1) = __builtin_bswap64(Absolute);
-		return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, 9);
-	}
+	return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, MINICBOR(encode_head)(Bytes, Major, Absolute));
 }
 
 int MINICBOR(write_integer)(MINICBOR_WRITE_PARAMS, int64_t Number) {
 	if (Number < 0) {
-		return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, ~Number, 0x20);
+		return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, ~Number, 1);
 	} else {
-		return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Number, 0x0);
+		return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Number, 0);
 	}
 }
 
 int MINICBOR(write_positive)(MINICBOR_WRITE_PARAMS, uint64_t Number) {
-	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Number, 0x0);
+	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Number, 0);
 }
 
 int MINICBOR(write_negative)(MINICBOR_WRITE_PARAMS, uint64_t Number) {
-	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Number, 0x20);
+	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Number, 1);
 }
 
 int MINICBOR(write_bytes)(MINICBOR_WRITE_PARAMS, size_t Size) {
-	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Size, 0x40);
+	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Size, 2);
 }
 
 int MINICBOR(write_indef_bytes)(MINICBOR_WRITE_PARAMS) {
@@ -75,7 +57,7 @@ int MINICBOR(write_indef_bytes)(MINICBOR_WRITE_PARAMS) {
 }
 
 int MINICBOR(write_string)(MINICBOR_WRITE_PARAMS, size_t Size) {
-	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Size, 0x60);
+	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Size, 3);
 }
 
 int MINICBOR(write_indef_string)(MINICBOR_WRITE_PARAMS) {
@@ -84,7 +66,7 @@ int MINICBOR(write_indef_string)(MINICBOR_WRITE_PARAMS) {
 }
 
 int MINICBOR(write_array)(MINICBOR_WRITE_PARAMS, size_t Size) {
-	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Size, 0x80);
+	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Size, 4);
 }
 
 int MINICBOR(write_indef_array)(MINICBOR_WRITE_PARAMS) {
@@ -93,7 +75,7 @@ int MINICBOR(write_indef_array)(MINICBOR_WRITE_PARAMS) {
 }
 
 int MINICBOR(write_map)(MINICBOR_WRITE_PARAMS, size_t Size) {
-	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Size, 0xA0);
+	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Size, 5);
 }
 
 int MINICBOR(write_indef_map)(MINICBOR_WRITE_PARAMS) {
@@ -107,13 +89,83 @@ int MINICBOR(write_simple)(MINICBOR_WRITE_PARAMS, unsigned char Simple) {
 #else
 	unsigned char Bytes[2];
 #endif
-	if (Simple < 24) {
-		Bytes[0] = Simple + 0xE0;
-		return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, 1);
-	} else {
-		Bytes[0] = 0xF8;
-		Bytes[1] = Simple;
-		return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, 2);
+	return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, MINICBOR(encode_simple)(Bytes, Simple));
+}
+
+/*
+ * Converts a double to the bits of the nearest half precision number (ties to even), overflowing to infinity.
+ * NaNs keep their sign and the top bits of their payload (a NaN whose payload is entirely in the low bits becomes a quiet NaN).
+ */
+static uint16_t MINICBOR(double_to_half)(double Number) {
+	uint64_t Bits;
+	memcpy(&Bits, &Number, 8);
+	uint16_t Sign = (Bits >> 48) & 0x8000;
+	int Exponent = (Bits >> 52) & 0x7FF;
+	uint64_t Mantissa = Bits & 0xFFFFFFFFFFFFF;
+	if (Exponent == 0x7FF) {
+		uint16_t Payload = Mantissa >> 42;
+		return Sign | 0x7C00 | (Mantissa && !Payload ? 0x200 : Payload);
+	}
+	// Rebias the exponent, smaller numbers become half subnormals (or zero)
+	Exponent -= 1023 - 15;
+	if (Exponent >= 31) return Sign | 0x7C00;
+	int Shift = 42;
+	if (Exponent <= 0) {
+		if (Exponent < -10) return Sign;
+		Shift += 1 - Exponent;
+		Exponent = 0;
+	}
+	Mantissa |= 1ULL << 52;
+	uint16_t Half = ((Exponent ? Exponent - 1 : 0) << 10) + (Mantissa >> Shift);
+	uint64_t Rest = Mantissa & ((1ULL << Shift) - 1), Tie = 1ULL << (Shift - 1);
+	// Rounding up may carry into the exponent, up to infinity
+	if (Rest > Tie || (Rest == Tie && (Half & 1))) ++Half;
+	return Sign | Half;
+}
+
+size_t MINICBOR(encode_float2)(unsigned char *Bytes, double Number) {
+	uint16_t Half = __builtin_bswap16(MINICBOR(double_to_half)(Number));
+	Bytes[0] = 0xF9;
+	memcpy(Bytes + 1, &Half, 2);
+	return 3;
+}
+
+size_t MINICBOR(size_float)(double Number) {
+	uint64_t Bits;
+	memcpy(&Bits, &Number, 8);
+	int Exponent = (Bits >> 52) & 0x7FF;
+	uint64_t Mantissa = Bits & 0xFFFFFFFFFFFFF;
+	if (Exponent == 0x7FF) {
+		// Infinities and NaNs take the smallest width with room for their payload
+		if (Mantissa & 0x1FFFFFFF) return 9;
+		if (Mantissa & 0x3FFFFFFFFFF) return 5;
+		return 3;
+	}
+	float Single = Number;
+	if (Single != Number) return 9;
+	// Half precision has exponents -14 to 15 (down to -24 for subnormals) and 10 mantissa bits, less for subnormals
+	int Power = Exponent - 1023;
+	if (!Exponent ? !Mantissa : Power >= -24 && Power <= 15 && !(Mantissa & ((1ULL << (Power >= -14 ? 42 : 28 - Power)) - 1))) {
+		return 3;
+	}
+	return 5;
+}
+
+size_t MINICBOR(encode_float)(unsigned char *Bytes, double Number) {
+	switch (MINICBOR(size_float)(Number)) {
+	case 3: return MINICBOR(encode_float2)(Bytes, Number);
+	case 5:
+		if (Number != Number) {
+			// Converting to single precision would quieten signalling NaNs, so the payload is copied directly
+			uint64_t Bits;
+			memcpy(&Bits, &Number, 8);
+			uint32_t Single = __builtin_bswap32((uint32_t)(Bits >> 32 & 0x80000000) | 0x7F800000 | (uint32_t)((Bits & 0xFFFFFFFFFFFFF) >> 29));
+			Bytes[0] = 0xFA;
+			memcpy(Bytes + 1, &Single, 4);
+			return 5;
+		}
+		return MINICBOR(encode_float4)(Bytes, Number);
+	default: return MINICBOR(encode_float8)(Bytes, Number);
 	}
 }
 
@@ -123,31 +175,7 @@ int MINICBOR(write_float2)(MINICBOR_WRITE_PARAMS, double Number) {
 #else
 	unsigned char Bytes[3];
 #endif
-	Bytes[0] = 0xF9;
-	int Inf = isinf(Number);
-	if (Inf < 0) {
-		Bytes[1] = 0x00;
-		Bytes[2] = 0xFC;
-	} else if (Inf > 0) {
-		Bytes[1] = 0x00;
-		Bytes[2] = 0x7C;
-	} else if (isnan(Number)) {
-		Bytes[1] = 0x01;
-		Bytes[2] = 0x7C;
-	} else {
-		int Sign = signbit(Number);
-		int Exponent;
-		int Mantissa = (int)(frexp(Number, &Exponent) * 2048) & 1023;
-		Exponent += 15;
-		if (Exponent < 0 || Exponent > 30) {
-			Bytes[1] = 0x00;
-			Bytes[2] = Sign ? 0xFC : 0x7C;
-		} else {
-			Bytes[1] = Mantissa & 255;
-			Bytes[2] = (Mantissa >> 8) | (Exponent << 2) | (Sign << 7);
-		}
-	}
-	return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, 3);
+	return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, MINICBOR(encode_float2)(Bytes, Number));
 }
 
 int MINICBOR(write_float4)(MINICBOR_WRITE_PARAMS, double Number) {
@@ -156,14 +184,7 @@ int MINICBOR(write_float4)(MINICBOR_WRITE_PARAMS, double Number) {
 #else
 	unsigned char Bytes[5];
 #endif
-	Bytes[0] = 0xFA;
-	*(float *)(Bytes + 1) = Number;
-	for (int I = 3; --I > 0;) {
-		unsigned char T = Bytes[I];
-		Bytes[I] = Bytes[5 - I];
-		Bytes[5 - I] = T;
-	}
-	return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, 5);
+	return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, MINICBOR(encode_float4)(Bytes, Number));
 }
 
 int MINICBOR(write_float8)(MINICBOR_WRITE_PARAMS, double Number) {
@@ -172,14 +193,16 @@ int MINICBOR(write_float8)(MINICBOR_WRITE_PARAMS, double Number) {
 #else
 	unsigned char Bytes[9];
 #endif
-	Bytes[0] = 0xFB;
-	*(double *)(Bytes + 1) = Number;
-	for (int I = 5; --I > 0;) {
-		unsigned char T = Bytes[I];
-		Bytes[I] = Bytes[9 - I];
-		Bytes[9 - I] = T;
-	}
-	return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, 9);
+	return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, MINICBOR(encode_float8)(Bytes, Number));
+}
+
+int MINICBOR(write_float)(MINICBOR_WRITE_PARAMS, double Number) {
+#ifdef MINICBOR_WRITE_BUFFER
+	unsigned char *Bytes = MINICBOR_WRITE_BUFFER(UserData);
+#else
+	unsigned char Bytes[9];
+#endif
+	return MINICBOR(write)(MINICBOR_WRITE_ARGS, Bytes, MINICBOR(encode_float)(Bytes, Number));
 }
 
 int MINICBOR(write_break)(MINICBOR_WRITE_PARAMS) {
@@ -188,6 +211,357 @@ int MINICBOR(write_break)(MINICBOR_WRITE_PARAMS) {
 }
 
 int MINICBOR(write_tag)(MINICBOR_WRITE_PARAMS, uint64_t Tag) {
-	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Tag, 0xC0);
+	return MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Tag, 6);
+}
+
+/*
+ * Typed arrays and arrays of numbers are encoded into blocks of this size on the stack.
+ */
+#ifndef MINICBOR_WRITE_BLOCK
+#define MINICBOR_WRITE_BLOCK 1024
+#endif
+
+static inline size_t MINICBOR(typed_width)(minicbor_typed_t Type) {
+	return (Type & 0x10) ? 2 << (Type & 3) : 1 << (Type & 3);
+}
+
+/*
+ * Copies Size bytes of elements of Width bytes from Source to Target, reversing the bytes of each element.
+ * Elements narrower than 8 bytes are swapped a word at a time.
+ */
+static void MINICBOR(swap_elements)(unsigned char *Target, const unsigned char *Source, size_t Size, size_t Width) {
+	size_t Index = 0;
+	switch (Width) {
+	case 2:
+		for (; Index + 8 <= Size; Index += 8) {
+			uint64_t Word;
+			memcpy(&Word, Source + Index, 8);
+			Word = ((Word >> 8) & 0x00FF00FF00FF00FF) | ((Word & 0x00FF00FF00FF00FF) << 8);
+			memcpy(Target + Index, &Word, 8);
+		}
+		for (; Index < Size; Index += 2) {
+			uint16_t Half;
+			memcpy(&Half, Source + Index, 2);
+			Half = __builtin_bswap16(Half);
+			memcpy(Target + Index, &Half, 2);
+		}
+		break;
+	case 4:
+		for (; Index + 8 <= Size; Index += 8) {
+			uint64_t Word;
+			memcpy(&Word, Source + Index, 8);
+			Word = __builtin_bswap64(Word);
+			Word = (Word >> 32) | (Word << 32);
+			memcpy(Target + Index, &Word, 8);
+		}
+		for (; Index < Size; Index += 4) {
+			uint32_t Single;
+			memcpy(&Single, Source + Index, 4);
+			Single = __builtin_bswap32(Single);
+			memcpy(Target + Index, &Single, 4);
+		}
+		break;
+	case 8:
+		for (; Index < Size; Index += 8) {
+			uint64_t Word;
+			memcpy(&Word, Source + Index, 8);
+			Word = __builtin_bswap64(Word);
+			memcpy(Target + Index, &Word, 8);
+		}
+		break;
+	default: __builtin_unreachable();
+	}
+}
+
+/*
+ * Returns 1 if the elements of a typed array need byte swapping, i.e. if they are wider than a byte and big-endian (minicbor assumes a little-endian host).
+ */
+static inline int MINICBOR(typed_swap)(minicbor_typed_t Type, size_t Width) {
+	return Width > 1 && !(Type & MINICBOR_TYPED_LITTLE);
+}
+
+int MINICBOR(write_typed_array)(MINICBOR_WRITE_PARAMS, minicbor_typed_t Type, const void *Values, size_t Count) {
+	size_t Width = MINICBOR(typed_width)(Type);
+	if (Width == 1) Type &= ~MINICBOR_TYPED_LITTLE;
+	size_t Size = Count * Width;
+	int Status = MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Type, 6);
+	if (Status < 0) return Status;
+	Status = MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Size, 2);
+	if (Status < 0 || !Size) return Status;
+	if (!MINICBOR(typed_swap)(Type, Width)) return MINICBOR(write)(MINICBOR_WRITE_ARGS, Values, Size);
+	unsigned char Block[MINICBOR_WRITE_BLOCK];
+	const unsigned char *Source = (const unsigned char *)Values;
+	while (Size) {
+		size_t Length = Size < sizeof(Block) ? Size : sizeof(Block);
+		MINICBOR(swap_elements)(Block, Source, Length, Width);
+		Status = MINICBOR(write)(MINICBOR_WRITE_ARGS, Block, Length);
+		if (Status < 0) return Status;
+		Source += Length;
+		Size -= Length;
+	}
+	return Status;
+}
+
+enum {
+	MWI_INT64,
+	MWI_UINT64,
+	MWI_INT32,
+	MWI_UINT32,
+	MWI_DOUBLE,
+	MWI_FLOAT
+};
+
+/*
+ * Encodes the number at Index in Values (of type Kind) with the smallest width.
+ */
+static inline size_t MINICBOR(encode_number_at)(unsigned char *Bytes, const void *Values, size_t Index, int Kind) {
+	switch (Kind) {
+	case MWI_INT64: {
+		int64_t Number = ((const int64_t *)Values)[Index];
+		return Number < 0 ? MINICBOR(encode_head)(Bytes, 1, ~Number) : MINICBOR(encode_head)(Bytes, 0, Number);
+	}
+	case MWI_UINT64: return MINICBOR(encode_head)(Bytes, 0, ((const uint64_t *)Values)[Index]);
+	case MWI_INT32: {
+		int32_t Number = ((const int32_t *)Values)[Index];
+		return Number < 0 ? MINICBOR(encode_head)(Bytes, 1, ~Number) : MINICBOR(encode_head)(Bytes, 0, Number);
+	}
+	case MWI_UINT32: return MINICBOR(encode_head)(Bytes, 0, ((const uint32_t *)Values)[Index]);
+	case MWI_DOUBLE: return MINICBOR(encode_float)(Bytes, ((const double *)Values)[Index]);
+	case MWI_FLOAT: return MINICBOR(encode_float)(Bytes, ((const float *)Values)[Index]);
+	default: __builtin_unreachable();
+	}
+}
+
+static int MINICBOR(write_numbers)(MINICBOR_WRITE_PARAMS, const void *Values, size_t Count, int Kind) {
+	int Status = MINICBOR(write_number)(MINICBOR_WRITE_ARGS, Count, 4);
+	if (Status < 0) return Status;
+	unsigned char Block[MINICBOR_WRITE_BLOCK];
+	size_t Used = 0;
+	for (size_t Index = 0; Index < Count; ++Index) {
+		if (Used > sizeof(Block) - 9) {
+			Status = MINICBOR(write)(MINICBOR_WRITE_ARGS, Block, Used);
+			if (Status < 0) return Status;
+			Used = 0;
+		}
+		Used += MINICBOR(encode_number_at)(Block + Used, Values, Index, Kind);
+	}
+	if (Used) Status = MINICBOR(write)(MINICBOR_WRITE_ARGS, Block, Used);
+	return Status;
+}
+
+int MINICBOR(write_array_of_int64)(MINICBOR_WRITE_PARAMS, const int64_t *Values, size_t Count) {
+	return MINICBOR(write_numbers)(MINICBOR_WRITE_ARGS, Values, Count, MWI_INT64);
+}
+
+int MINICBOR(write_array_of_uint64)(MINICBOR_WRITE_PARAMS, const uint64_t *Values, size_t Count) {
+	return MINICBOR(write_numbers)(MINICBOR_WRITE_ARGS, Values, Count, MWI_UINT64);
+}
+
+int MINICBOR(write_array_of_int32)(MINICBOR_WRITE_PARAMS, const int32_t *Values, size_t Count) {
+	return MINICBOR(write_numbers)(MINICBOR_WRITE_ARGS, Values, Count, MWI_INT32);
+}
+
+int MINICBOR(write_array_of_uint32)(MINICBOR_WRITE_PARAMS, const uint32_t *Values, size_t Count) {
+	return MINICBOR(write_numbers)(MINICBOR_WRITE_ARGS, Values, Count, MWI_UINT32);
+}
+
+int MINICBOR(write_array_of_double)(MINICBOR_WRITE_PARAMS, const double *Values, size_t Count) {
+	return MINICBOR(write_numbers)(MINICBOR_WRITE_ARGS, Values, Count, MWI_DOUBLE);
+}
+
+int MINICBOR(write_array_of_float)(MINICBOR_WRITE_PARAMS, const float *Values, size_t Count) {
+	return MINICBOR(write_numbers)(MINICBOR_WRITE_ARGS, Values, Count, MWI_FLOAT);
+}
+
+size_t MINICBOR(size_typed_array)(minicbor_typed_t Type, size_t Count) {
+	size_t Size = Count * MINICBOR(typed_width)(Type);
+	// Typed array tags are all between 64 and 87
+	return 2 + MINICBOR(size_head)(Size) + Size;
+}
+
+/*
+ * The loops below have no branches in their bodies, so the compiler can unroll or vectorise them where the target allows.
+ */
+size_t MINICBOR(size_array_of_int64)(const int64_t *Values, size_t Count) {
+	size_t Size = MINICBOR(size_head)(Count);
+	for (size_t Index = 0; Index < Count; ++Index) Size += MINICBOR(size_integer)(Values[Index]);
+	return Size;
+}
+
+size_t MINICBOR(size_array_of_uint64)(const uint64_t *Values, size_t Count) {
+	size_t Size = MINICBOR(size_head)(Count);
+	for (size_t Index = 0; Index < Count; ++Index) Size += MINICBOR(size_head)(Values[Index]);
+	return Size;
+}
+
+size_t MINICBOR(size_array_of_int32)(const int32_t *Values, size_t Count) {
+	size_t Size = MINICBOR(size_head)(Count);
+	for (size_t Index = 0; Index < Count; ++Index) {
+		uint32_t Number = Values[Index] ^ (Values[Index] >> 31);
+		Size += 1 + (Number > 23) + (Number > 0xFF) + 2 * (Number > 0xFFFF);
+	}
+	return Size;
+}
+
+size_t MINICBOR(size_array_of_uint32)(const uint32_t *Values, size_t Count) {
+	size_t Size = MINICBOR(size_head)(Count);
+	for (size_t Index = 0; Index < Count; ++Index) {
+		uint32_t Number = Values[Index];
+		Size += 1 + (Number > 23) + (Number > 0xFF) + 2 * (Number > 0xFFFF);
+	}
+	return Size;
+}
+
+size_t MINICBOR(size_array_of_double)(const double *Values, size_t Count) {
+	size_t Size = MINICBOR(size_head)(Count);
+	for (size_t Index = 0; Index < Count; ++Index) Size += MINICBOR(size_float)(Values[Index]);
+	return Size;
+}
+
+size_t MINICBOR(size_array_of_float)(const float *Values, size_t Count) {
+	size_t Size = MINICBOR(size_head)(Count);
+	for (size_t Index = 0; Index < Count; ++Index) Size += MINICBOR(size_float)(Values[Index]);
+	return Size;
+}
+
+static inline void MINICBOR(buffer_segment)(minicbor_buffer_writer_t *Writer) {
+	if (Writer->Next > Writer->Segment) {
+		struct iovec *Region = Writer->Vector + Writer->Count++;
+		Region->iov_base = Writer->Segment;
+		Region->iov_len = Writer->Next - Writer->Segment;
+		Writer->Segment = Writer->Next;
+	}
+}
+
+struct iovec *MINICBOR(buffer_gathered)(minicbor_buffer_writer_t *Writer, int *Count) {
+	MINICBOR(buffer_segment)(Writer);
+	*Count = Writer->Count;
+	return Writer->Vector;
 }
 
+int MINICBOR(buffer_flush)(minicbor_buffer_writer_t *Writer) {
+	if (Writer->Vector) {
+		if (!Writer->WritevFn) return -1;
+		MINICBOR(buffer_segment)(Writer);
+		int Status = Writer->Count ? Writer->WritevFn(Writer->UserData, Writer->Vector, Writer->Count) : 0;
+		MINICBOR(buffer_reset)(Writer);
+		return Status;
+	}
+	size_t Buffered = Writer->Next - Writer->Start;
+	if (!Buffered) return 0;
+	Writer->Next = Writer->Start;
+	return MINICBOR(write)(MINICBOR_BUFFER_ARGS(Writer), Writer->Start, Buffered);
+}
+
+int MINICBOR(buffer_write_large)(minicbor_buffer_writer_t *Writer, const void *Bytes, size_t Size) {
+	if (Writer->Vector) {
+		if (Size < Writer->Threshold) {
+			// Smaller payloads which did not fit are still copied, they may not outlive this call
+			int Status = MINICBOR(buffer_flush)(Writer);
+			if (Status < 0) return Status;
+			if (Size > (size_t)(Writer->Limit - Writer->Next)) {
+				// Larger than the buffer, written now (flushing succeeded so WritevFn is set)
+				struct iovec Region = {(void *)Bytes, Size};
+				Status = Writer->WritevFn(Writer->UserData, &Region, 1);
+				return Status < 0 ? Status : 0;
+			}
+			memcpy(Writer->Next, Bytes, Size);
+			Writer->Next += Size;
+			return 0;
+		}
+		// Keep a free entry so that MINICBOR(buffer_gathered)() can always record the last segment.
+		if (Writer->Capacity - Writer->Count < 3) {
+			int Status = MINICBOR(buffer_flush)(Writer);
+			if (Status < 0) return Status;
+		}
+		MINICBOR(buffer_segment)(Writer);
+		struct iovec *Region = Writer->Vector + Writer->Count++;
+		Region->iov_base = (void *)Bytes;
+		Region->iov_len = Size;
+		return 0;
+	}
+	size_t Buffered = Writer->Next - Writer->Start;
+	if (Size < (size_t)(Writer->Limit - Writer->Start) / 2) {
+		int Status = MINICBOR(buffer_flush)(Writer);
+		if (Status < 0) return Status;
+		memcpy(Writer->Next, Bytes, Size);
+		Writer->Next += Size;
+		return 0;
+	}
+	Writer->Next = Writer->Start;
+	int Status;
+	if (Buffered && Writer->WritevFn) {
+		struct iovec Vector[2] = {
+			{Writer->Start, Buffered},
+			{(void *)Bytes, Size}
+		};
+		Status = Writer->WritevFn(Writer->UserData, Vector, 2);
+	} else {
+		if (Buffered) {
+			Status = MINICBOR(write)(MINICBOR_BUFFER_ARGS(Writer), Writer->Start, Buffered);
+			if (Status < 0) return Status;
+		}
+		Status = MINICBOR(write)(MINICBOR_BUFFER_ARGS(Writer), Bytes, Size);
+	}
+	return Status < 0 ? Status : 0;
+}
+
+int MINICBOR(buffer_write_typed_array)(minicbor_buffer_writer_t *Writer, minicbor_typed_t Type, const void *Values, size_t Count) {
+	size_t Width = MINICBOR(typed_width)(Type);
+	if (Width == 1) Type &= ~MINICBOR_TYPED_LITTLE;
+	size_t Size = Count * Width;
+	int Status = MINICBOR(buffer_write_head)(Writer, 6, Type);
+	if (Status) return Status;
+	Status = MINICBOR(buffer_write_head)(Writer, 2, Size);
+	if (Status) return Status;
+	if (!MINICBOR(typed_swap)(Type, Width)) return MINICBOR(buffer_write_data)(Writer, Values, Size);
+	const unsigned char *Source = (const unsigned char *)Values;
+	while (Size) {
+		size_t Length = (Writer->Limit - Writer->Next) / Width * Width;
+		if (!Length) {
+			Status = MINICBOR(buffer_flush)(Writer);
+			if (Status < 0) return Status;
+			continue;
+		}
+		if (Length > Size) Length = Size;
+		MINICBOR(swap_elements)(Writer->Next, Source, Length, Width);
+		Writer->Next += Length;
+		Source += Length;
+		Size -= Length;
+	}
+	return 0;
+}
+
+static int MINICBOR(buffer_write_numbers)(minicbor_buffer_writer_t *Writer, const void *Values, size_t Count, int Kind) {
+	int Status = MINICBOR(buffer_write_head)(Writer, 4, Count);
+	if (Status) return Status;
+	for (size_t Index = 0; Index < Count; ++Index) {
+		if ((Status = MINICBOR(buffer_reserve)(Writer))) return Status;
+		Writer->Next += MINICBOR(encode_number_at)(Writer->Next, Values, Index, Kind);
+	}
+	return 0;
+}
+
+int MINICBOR(buffer_write_array_of_int64)(minicbor_buffer_writer_t *Writer, const int64_t *Values, size_t Count) {
+	return MINICBOR(buffer_write_numbers)(Writer, Values, Count, MWI_INT64);
+}
+
+int MINICBOR(buffer_write_array_of_uint64)(minicbor_buffer_writer_t *Writer, const uint64_t *Values, size_t Count) {
+	return MINICBOR(buffer_write_numbers)(Writer, Values, Count, MWI_UINT64);
+}
+
+int MINICBOR(buffer_write_array_of_int32)(minicbor_buffer_writer_t *Writer, const int32_t *Values, size_t Count) {
+	return MINICBOR(buffer_write_numbers)(Writer, Values, Count, MWI_INT32);
+}
+
+int MINICBOR(buffer_write_array_of_uint32)(minicbor_buffer_writer_t *Writer, const uint32_t *Values, size_t Count) {
+	return MINICBOR(buffer_write_numbers)(Writer, Values, Count, MWI_UINT32);
+}
+
+int MINICBOR(buffer_write_array_of_double)(minicbor_buffer_writer_t *Writer, const double *Values, size_t Count) {
+	return MINICBOR(buffer_write_numbers)(Writer, Values, Count, MWI_DOUBLE);
+}
+
+int MINICBOR(buffer_write_array_of_float)(minicbor_buffer_writer_t *Writer, const float *Values, size_t Count) {
+	return MINICBOR(buffer_write_numbers)(Writer, Values, Count, MWI_FLOAT);
+}
@@ -0,0 +1,169 @@
+/*
+ * Header-only writer functions for a sink fixed at compile time, with no include guard: include this file once per sink.
+ * Define before including:
+ *
+ *   MINICBOR_IMPL_PREFIX           prefix of the generated functions, e.g. hash_ for hash_write_integer().
+ *   MINICBOR_IMPL_SINK             type of the sink argument passed as the first argument to every function.
+ *   MINICBOR_IMPL_WRITE(S, B, N)   writes N bytes at B to sink S, evaluating to 0 or a negative error.
+ *
+ * and optionally, for sinks which can encode directly into their own memory:
+ *
+ *   MINICBOR_IMPL_RESERVE(S, N)    evaluates to an unsigned char * with room for N bytes (at most 9) in sink S, or NULL.
+ *   MINICBOR_IMPL_COMMIT(S, E)     ends the reserved space at E.
+ *
+ * Defining MINICBOR_IMPL_NO_DATA omits write_bytes_data() and write_string_data(), for sinks which provide their own.
+ * These macros are undefined again at the end of this file.
+ */
+
+#include "minicbor.h"
+
+#ifndef MINICBOR_IMPL_PREFIX
+#error "MINICBOR_IMPL_PREFIX must be defined before including minicbor_writer_impl.h"
+#endif
+
+#ifndef MINICBOR_IMPL_SINK
+#error "MINICBOR_IMPL_SINK must be defined before including minicbor_writer_impl.h"
+#endif
+
+#ifndef MINICBOR_IMPL_WRITE
+#error "MINICBOR_IMPL_WRITE must be defined before including minicbor_writer_impl.h"
+#endif
+
+#if defined(MINICBOR_IMPL_RESERVE) != defined(MINICBOR_IMPL_COMMIT)
+#error "MINICBOR_IMPL_RESERVE and MINICBOR_IMPL_COMMIT must be defined together"
+#endif
+
+#define MINICBOR_IMPL(SUFFIX) MINICBOR_CONCAT(MINICBOR_IMPL_PREFIX, SUFFIX)
+
+/*
+ * Encodes at most MAX bytes with ENCODE (an expression using Bytes) into reserved space if possible, otherwise on the stack.
+ */
+#ifdef MINICBOR_IMPL_RESERVE
+#define MINICBOR_IMPL_EMIT(MAX, ENCODE) { \
+	unsigned char *Bytes = MINICBOR_IMPL_RESERVE(Sink, MAX); \
+	if (__builtin_expect(Bytes != NULL, 1)) { \
+		MINICBOR_IMPL_COMMIT(Sink, Bytes + ENCODE); \
+		return 0; \
+	} \
+} \
+	unsigned char Bytes[MAX]; \
+	return MINICBOR_IMPL_WRITE(Sink, Bytes, ENCODE);
+#else
+#define MINICBOR_IMPL_EMIT(MAX, ENCODE) \
+	unsigned char Bytes[MAX]; \
+	return MINICBOR_IMPL_WRITE(Sink, Bytes, ENCODE);
+#endif
+
+static inline int MINICBOR_IMPL(write_head)(MINICBOR_IMPL_SINK Sink, unsigned char Major, uint64_t Number) {
+	MINICBOR_IMPL_EMIT(9, MINICBOR(encode_head)(Bytes, Major, Number))
+}
+
+static inline int MINICBOR_IMPL(write_byte)(MINICBOR_IMPL_SINK Sink, unsigned char Byte) {
+	MINICBOR_IMPL_EMIT(1, (Bytes[0] = Byte, 1))
+}
+
+static inline int MINICBOR_IMPL(write_integer)(MINICBOR_IMPL_SINK Sink, int64_t Number) {
+	if (Number < 0) {
+		return MINICBOR_IMPL(write_head)(Sink, 1, ~Number);
+	} else {
+		return MINICBOR_IMPL(write_head)(Sink, 0, Number);
+	}
+}
+
+static inline int MINICBOR_IMPL(write_positive)(MINICBOR_IMPL_SINK Sink, uint64_t Number) {
+	return MINICBOR_IMPL(write_head)(Sink, 0, Number);
+}
+
+static inline int MINICBOR_IMPL(write_negative)(MINICBOR_IMPL_SINK Sink, uint64_t Number) {
+	return MINICBOR_IMPL(write_head)(Sink, 1, Number);
+}
+
+static inline int MINICBOR_IMPL(write_bytes)(MINICBOR_IMPL_SINK Sink, size_t Size) {
+	return MINICBOR_IMPL(write_head)(Sink, 2, Size);
+}
+
+static inline int MINICBOR_IMPL(write_indef_bytes)(MINICBOR_IMPL_SINK Sink) {
+	return MINICBOR_IMPL(write_byte)(Sink, 0x5F);
+}
+
+static inline int MINICBOR_IMPL(write_string)(MINICBOR_IMPL_SINK Sink, size_t Size) {
+	return MINICBOR_IMPL(write_head)(Sink, 3, Size);
+}
+
+static inline int MINICBOR_IMPL(write_indef_string)(MINICBOR_IMPL_SINK Sink) {
+	return MINICBOR_IMPL(write_byte)(Sink, 0x7F);
+}
+
+static inline int MINICBOR_IMPL(write_array)(MINICBOR_IMPL_SINK Sink, size_t Size) {
+	return MINICBOR_IMPL(write_head)(Sink, 4, Size);
+}
+
+static inline int MINICBOR_IMPL(write_indef_array)(MINICBOR_IMPL_SINK Sink) {
+	return MINICBOR_IMPL(write_byte)(Sink, 0x9F);
+}
+
+static inline int MINICBOR_IMPL(write_map)(MINICBOR_IMPL_SINK Sink, size_t Size) {
+	return MINICBOR_IMPL(write_head)(Sink, 5, Size);
+}
+
+static inline int MINICBOR_IMPL(write_indef_map)(MINICBOR_IMPL_SINK Sink) {
+	return MINICBOR_IMPL(write_byte)(Sink, 0xBF);
+}
+
+static inline int MINICBOR_IMPL(write_tag)(MINICBOR_IMPL_SINK Sink, uint64_t Tag) {
+	return MINICBOR_IMPL(write_head)(Sink, 6, Tag);
+}
+
+static inline int MINICBOR_IMPL(write_simple)(MINICBOR_IMPL_SINK Sink, unsigned char Simple) {
+	MINICBOR_IMPL_EMIT(2, MINICBOR(encode_simple)(Bytes, Simple))
+}
+
+static inline int MINICBOR_IMPL(write_float2)(MINICBOR_IMPL_SINK Sink, double Number) {
+	MINICBOR_IMPL_EMIT(3, MINICBOR(encode_float2)(Bytes, Number))
+}
+
+static inline int MINICBOR_IMPL(write_float4)(MINICBOR_IMPL_SINK Sink, double Number) {
+	MINICBOR_IMPL_EMIT(5, MINICBOR(encode_float4)(Bytes, Number))
+}
+
+static inline int MINICBOR_IMPL(write_float8)(MINICBOR_IMPL_SINK Sink, double Number) {
+	MINICBOR_IMPL_EMIT(9, MINICBOR(encode_float8)(Bytes, Number))
+}
+
+static inline int MINICBOR_IMPL(write_float)(MINICBOR_IMPL_SINK Sink, double Number) {
+	MINICBOR_IMPL_EMIT(9, MINICBOR(encode_float)(Bytes, Number))
+}
+
+static inline int MINICBOR_IMPL(write_break)(MINICBOR_IMPL_SINK Sink) {
+	return MINICBOR_IMPL(write_byte)(Sink, 0xFF);
+}
+
+#ifndef MINICBOR_IMPL_NO_DATA
+
+/*
+ * Writes the head of a bytestring or string followed by its contents.
+ */
+static inline int MINICBOR_IMPL(write_bytes_data)(MINICBOR_IMPL_SINK Sink, const void *Bytes, size_t Size) {
+	int Status = MINICBOR_IMPL(write_head)(Sink, 2, Size);
+	if (Status < 0) return Status;
+	return MINICBOR_IMPL_WRITE(Sink, Bytes, Size);
+}
+
+static inline int MINICBOR_IMPL(write_string_data)(MINICBOR_IMPL_SINK Sink, const char *String, size_t Length) {
+	int Status = MINICBOR_IMPL(write_head)(Sink, 3, Length);
+	if (Status < 0) return Status;
+	return MINICBOR_IMPL_WRITE(Sink, String, Length);
+}
+
+#endif
+
+#undef MINICBOR_IMPL_EMIT
+#undef MINICBOR_IMPL
+#undef MINICBOR_IMPL_PREFIX
+#undef MINICBOR_IMPL_SINK
+#undef MINICBOR_IMPL_WRITE
+#ifdef MINICBOR_IMPL_RESERVE
+#undef MINICBOR_IMPL_RESERVE
+#undef MINICBOR_IMPL_COMMIT
+#endif
+#undef MINICBOR_IMPL_NO_DATA
@@ -0,0 +1,715 @@
+#!/usr/bin/env python3
+"""
+Generates specialised C decoders and encoders from a subset of CDDL (RFC 8610).
+
+Supported rules:
+
+  point = { x: float, y: float, ? label: tstr }    ; map with text keys
+  cose_key = { 1 => int, "alg" => tstr, kid => bstr } ; integer and string keys
+  kid = 4                                          ; integer (or string) constants used as keys
+  pair = [name: tstr, value: int]                  ; array with a fixed number of items
+  path = { points: [0*16 point], tags: [* tstr] }  ; bounded and unbounded arrays
+  count = uint                                     ; aliases
+
+Primitive types are uint, nint, int, float, float16, float32, float64, tstr (text), bstr (bytes), bool and any.
+Each map or array rule becomes a C struct <rule>_t with the functions
+
+  int <rule>_decode(<rule>_t *Value, const void *Bytes, size_t Size);
+  int <rule>_encode(minicbor_buffer_writer_t *Writer, const <rule>_t *Value);
+
+Usage: minicbor_cddl.py [-o base] [-p prefix] schema.cddl, writes base.h and base.c (base defaults to the schema name with a _cbor suffix).
+The prefix is prepended to every generated type and function name.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+PRIMITIVES = {
+	"uint": "uint64_t",
+	"nint": "int64_t",
+	"int": "int64_t",
+	"float": "double",
+	"float16": "double",
+	"float32": "double",
+	"float64": "double",
+	"tstr": "minicbor_cddl_text_t",
+	"text": "minicbor_cddl_text_t",
+	"bstr": "minicbor_cddl_bytes_t",
+	"bytes": "minicbor_cddl_bytes_t",
+	"bool": "int",
+	"any": "minicbor_view_t"
+}
+
+C_KEYWORDS = {
+	"auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else", "enum", "extern",
+	"float", "for", "goto", "if", "inline", "int", "long", "register", "restrict", "return", "short", "signed",
+	"sizeof", "static", "struct", "switch", "typedef", "union", "unsigned", "void", "volatile", "while"
+}
+
+# Every map key is given one bit in a uint64_t while decoding
+MAX_FIELDS = 64
+
+class SchemaError(Exception):
+	pass
+
+TOKEN = re.compile(r'''
+	(?P<space>\s+|;[^\n]*) |
+	(?P<string>"(?:[^"\\]|\\.)*") |
+	(?P<number>-?(?:0x[0-9A-Fa-f]+|[0-9]+)) |
+	(?P<arrow>=>) |
+	(?P<punct>[{}\[\](),:=?*+]) |
+	(?P<ident>[A-Za-z@_$](?:[A-Za-z0-9@_$.\-]*[A-Za-z0-9@_$])?)
+''', re.VERBOSE)
+
+def tokenize(Source):
+	Tokens = []
+	Position = 0
+	while Position < len(Source):
+		Match = TOKEN.match(Source, Position)
+		if not Match:
+			Line = Source.count("\n", 0, Position) + 1
+			raise SchemaError(f"line {Line}: unexpected character {Source[Position]!r}")
+		Kind = Match.lastgroup
+		Text = Match.group(Kind)
+		Line = Source.count("\n", 0, Position) + 1
+		Position = Match.end()
+		if Kind == "space": continue
+		if Kind == "string":
+			Text = bytes(Text[1:-1], "utf-8").decode("unicode_escape").encode("latin-1").decode("utf-8")
+		elif Kind == "number":
+			Text = int(Text, 0)
+		elif Kind == "arrow" or Kind == "punct":
+			Kind = Text
+		Tokens.append((Kind, Text, Line))
+	Tokens.append(("end", None, Line if Tokens else 1))
+	return Tokens
+
+class Parser:
+	def __init__(self, Tokens):
+		self.Tokens = Tokens
+		self.Index = 0
+
+	def peek(self, Offset = 0):
+		return self.Tokens[min(self.Index + Offset, len(self.Tokens) - 1)]
+
+	def take(self, Kind = None):
+		Token = self.Tokens[self.Index]
+		if Kind is not None and Token[0] != Kind:
+			raise SchemaError(f"line {Token[2]}: expected {Kind}, found {Token[1] if Token[1] is not None else 'end of file'!r}")
+		self.Index += 1
+		return Token
+
+	def rules(self):
+		Rules = {}
+		while self.peek()[0] != "end":
+			Name = self.take("ident")
+			self.take("=")
+			if Name[1] in Rules: raise SchemaError(f"line {Name[2]}: duplicate rule {Name[1]}")
+			Rules[Name[1]] = (self.type(), Name[2])
+		return Rules
+
+	def type(self):
+		Kind, Text, Line = self.take()
+		if Kind == "{": return ("map", self.group("}"), Line)
+		if Kind == "[": return ("array", self.group("]"), Line)
+		if Kind == "number": return ("int", Text, Line)
+		if Kind == "string": return ("text", Text, Line)
+		if Kind == "ident": return ("ref", Text, Line)
+		raise SchemaError(f"line {Line}: expected a type, found {Text!r}")
+
+	def occurrence(self):
+		Kind, Text, Line = self.peek()
+		if Kind == "?":
+			self.take()
+			return (0, 1)
+		if Kind == "+":
+			self.take()
+			return (1, None)
+		if Kind == "*":
+			self.take()
+			if self.peek()[0] == "number" and self.peek(1)[0] not in (":", "=>"):
+				return (0, self.take()[1])
+			return (0, None)
+		if Kind == "number" and self.peek(1)[0] == "*":
+			Min = self.take()[1]
+			self.take()
+			if self.peek()[0] == "number" and self.peek(1)[0] not in (":", "=>"):
+				return (Min, self.take()[1])
+			return (Min, None)
+		return None
+
+	def group(self, Close):
+		Entries = []
+		while self.peek()[0] != Close:
+			Line = self.peek()[2]
+			Occurrence = self.occurrence()
+			Key = None
+			if self.peek()[0] in ("ident", "string", "number") and self.peek(1)[0] in (":", "=>"):
+				Kind, Text, _ = self.take()
+				Separator = self.take()[0]
+				Key = (Kind, Text, Separator)
+			Entries.append({"occurrence": Occurrence, "key": Key, "type": self.type(), "line": Line})
+			if self.peek()[0] == ",": self.take()
+			elif self.peek()[0] != Close:
+				Token = self.peek()
+				raise SchemaError(f"line {Token[2]}: expected , or {Close}, found {Token[1]!r}")
+		self.take(Close)
+		return Entries
+
+def c_name(Name):
+	Name = re.sub(r'[^A-Za-z0-9_]', '_', Name)
+	if Name[0].isdigit(): Name = "_" + Name
+	return Name + "_" if Name in C_KEYWORDS else Name
+
+def encode_head(Major, Number):
+	if Number < 24: return bytes([Major << 5 | Number])
+	if Number < 0x100: return bytes([Major << 5 | 24, Number])
+	if Number < 0x10000: return bytes([Major << 5 | 25]) + Number.to_bytes(2, "big")
+	if Number < 0x100000000: return bytes([Major << 5 | 26]) + Number.to_bytes(4, "big")
+	return bytes([Major << 5 | 27]) + Number.to_bytes(8, "big")
+
+def encode_key(Key):
+	if isinstance(Key, str):
+		Bytes = Key.encode("utf-8")
+		return encode_head(3, len(Bytes)) + Bytes
+	return encode_head(0, Key) if Key >= 0 else encode_head(1, -1 - Key)
+
+def c_bytes(Bytes):
+	Literal = ""
+	Escaped = False
+	for Byte in Bytes:
+		Char = chr(Byte)
+		if 0x20 <= Byte < 0x7F and Char not in '"\\?':
+			# A hex escape would continue into a following hex digit
+			if Escaped and Char in "0123456789abcdefABCDEF": Literal += '" "'
+			Literal += Char
+			Escaped = False
+		else:
+			Literal += f"\\x{Byte:02x}"
+			Escaped = True
+	return '"' + Literal + '"'
+
+class Schema:
+	def __init__(self, Rules, Prefix):
+		self.Rules = Rules
+		self.Prefix = Prefix
+		self.Structs = {}
+		self.Order = []
+		self.Resolving = set()
+		for Name, (Type, Line) in Rules.items():
+			if Type[0] in ("map", "array") and self.tuple_or_map(Type):
+				self.struct(Prefix + c_name(Name), Type)
+		for Name in list(self.Structs):
+			self.visit(Name, [])
+
+	def tuple_or_map(self, Type):
+		if Type[0] == "map": return True
+		Entries = Type[1]
+		return not (len(Entries) == 1 and Entries[0]["key"] is None and Entries[0]["occurrence"] is not None)
+
+	def constant(self, Name, Line):
+		Seen = set()
+		while Name in self.Rules and Name not in Seen:
+			Seen.add(Name)
+			Type = self.Rules[Name][0]
+			if Type[0] == "int" or Type[0] == "text": return Type[1]
+			if Type[0] != "ref": break
+			Name = Type[1]
+		raise SchemaError(f"line {Line}: {Name} is not an integer or string constant")
+
+	def resolve(self, Type, Owner, Field):
+		Kind, Value, Line = Type
+		if Kind == "ref":
+			if Value in PRIMITIVES: return ("prim", Value)
+			if Value not in self.Rules: raise SchemaError(f"line {Line}: undefined rule {Value}")
+			Target = self.Rules[Value][0]
+			if Target[0] in ("map", "array") and self.tuple_or_map(Target): return ("struct", self.Prefix + c_name(Value))
+			if Value in self.Resolving: raise SchemaError(f"line {Line}: recursive rule {Value}")
+			self.Resolving.add(Value)
+			try:
+				return self.resolve(Target, Owner, Field)
+			finally:
+				self.Resolving.discard(Value)
+		if Kind == "map" or (Kind == "array" and self.tuple_or_map(Type)):
+			Name = f"{Owner}_{Field}"
+			if Name in self.Structs or any(self.Prefix + c_name(Rule) == Name for Rule in self.Rules): raise SchemaError(f"line {Line}: generated name {Name} is already used")
+			self.struct(Name, Type)
+			return ("struct", Name)
+		if Kind == "array":
+			Entry = Value[0]
+			Min, Max = Entry["occurrence"]
+			Item = self.resolve(Entry["type"], Owner, Field + "_item")
+			if Max is None: return ("view", "array")
+			if Item[0] not in ("prim", "struct"): raise SchemaError(f"line {Line}: arrays of arrays must be unbounded")
+			if Max < 1 or Min > Max: raise SchemaError(f"line {Line}: invalid occurrence {Min}*{Max}")
+			return ("list", Item, Min, Max)
+		raise SchemaError(f"line {Line}: unsupported type {Value!r}")
+
+	def struct(self, Name, Type):
+		Kind, Entries, Line = Type
+		Fields = []
+		self.Structs[Name] = {"kind": Kind, "fields": Fields, "line": Line}
+		Names = set()
+		for Entry in Entries:
+			Key = Entry["key"]
+			Occurrence = Entry["occurrence"]
+			if Kind == "map":
+				if Key is None: raise SchemaError(f"line {Entry['line']}: map entries must have keys")
+				KeyKind, KeyText, Separator = Key
+				if Separator == "=>" and KeyKind == "ident" and KeyText in PRIMITIVES:
+					# Wildcard entries such as * tstr => any describe the keys which are skipped anyway
+					if Occurrence is None or Occurrence[1] is not None: raise SchemaError(f"line {Entry['line']}: unsupported wildcard entry")
+					continue
+				if Occurrence not in (None, (0, 1)): raise SchemaError(f"line {Entry['line']}: map entries can only be optional")
+				if KeyKind == "ident" and Separator == ":":
+					Value = KeyText
+					Field = KeyText
+				elif KeyKind == "ident":
+					Value = self.constant(KeyText, Entry["line"])
+					Field = KeyText
+				else:
+					Value = KeyText
+					Field = KeyText if KeyKind == "string" else (f"key_{KeyText}" if KeyText >= 0 else f"key_n{-KeyText}")
+				if isinstance(Value, int) and not -(1 << 64) <= Value < (1 << 64):
+					raise SchemaError(f"line {Entry['line']}: key {Value} out of range")
+			else:
+				if Key is None or Key[0] != "ident" or Key[2] != ":": raise SchemaError(f"line {Entry['line']}: array items must be named")
+				if Occurrence is not None: raise SchemaError(f"line {Entry['line']}: array items cannot be optional")
+				Value = None
+				Field = Key[1]
+			Field = c_name(Field)
+			if Field in Names: raise SchemaError(f"line {Entry['line']}: duplicate field {Field}")
+			Names.add(Field)
+			Fields.append({
+				"name": Field,
+				"key": Value,
+				"optional": Occurrence is not None,
+				"type": self.resolve(Entry["type"], Name, Field)
+			})
+		if Kind == "map":
+			Keys = [Field["key"] for Field in Fields]
+			if len(set(map(encode_key, Keys))) != len(Keys): raise SchemaError(f"line {Line}: duplicate keys in {Name}")
+			if sum(not Field["optional"] for Field in Fields) > MAX_FIELDS: raise SchemaError(f"line {Line}: too many required keys in {Name}")
+
+	def visit(self, Name, Path):
+		if Name in self.Order: return
+		if Name in Path: raise SchemaError(f"line {self.Structs[Name]['line']}: {Name} contains itself")
+		for Field in self.Structs[Name]["fields"]:
+			Type = Field["type"]
+			if Type[0] == "list": Type = Type[1]
+			if Type[0] == "struct": self.visit(Type[1], Path + [Name])
+		self.Order.append(Name)
+
+PRELUDE = r'''
+typedef struct {
+	const unsigned char *Next, *Limit;
+} cddl_cursor_t;
+
+static inline int cddl_head(cddl_cursor_t *C, unsigned char Major, uint64_t *Number) {
+	if (C->Next == C->Limit || (C->Next[0] >> 5) != Major) return 0;
+	size_t Length = MINICBOR(decode_head)(C->Next, C->Limit - C->Next, Number);
+	C->Next += Length;
+	return Length != 0;
+}
+
+/*
+ * Reads the head of an array or map, with Count set to UINT64_MAX if it is indefinite.
+ * Every item takes at least one byte, so longer definite lengths are rejected here.
+ */
+static inline int cddl_container(cddl_cursor_t *C, unsigned char Major, uint64_t *Count) {
+	const unsigned char *Head = C->Next;
+	if (!cddl_head(C, Major, Count)) return 0;
+	return (Head[0] & 0x1F) == 0x1F || *Count <= (uint64_t)(C->Limit - C->Next);
+}
+
+static inline int cddl_break(cddl_cursor_t *C) {
+	if (C->Next == C->Limit || C->Next[0] != 0xFF) return 0;
+	++C->Next;
+	return 1;
+}
+
+static inline int cddl_any(cddl_cursor_t *C, minicbor_view_t *View) {
+	minicbor_view_t Item = {C->Next, C->Limit};
+	const unsigned char *Bytes;
+	size_t Size;
+	if (C->Next == C->Limit || !MINICBOR(view_encoded)(Item, &Bytes, &Size)) return 0;
+	View->Head = Bytes;
+	View->Limit = C->Next += Size;
+	return 1;
+}
+
+static inline int cddl_skip(cddl_cursor_t *C) {
+	minicbor_view_t View;
+	return cddl_any(C, &View);
+}
+
+static inline int cddl_array(cddl_cursor_t *C, minicbor_view_t *View) {
+	return C->Next < C->Limit && (C->Next[0] >> 5) == 4 && cddl_any(C, View);
+}
+
+static inline int cddl_uint(cddl_cursor_t *C, uint64_t *Value) {
+	return cddl_head(C, 0, Value);
+}
+
+static inline int cddl_nint(cddl_cursor_t *C, int64_t *Value) {
+	uint64_t Number;
+	if (!cddl_head(C, 1, &Number) || Number > INT64_MAX) return 0;
+	*Value = ~(int64_t)Number;
+	return 1;
+}
+
+static inline int cddl_int(cddl_cursor_t *C, int64_t *Value) {
+	uint64_t Number;
+	if (C->Next < C->Limit && (C->Next[0] >> 5) == 1) return cddl_nint(C, Value);
+	if (!cddl_head(C, 0, &Number) || Number > INT64_MAX) return 0;
+	*Value = Number;
+	return 1;
+}
+
+static inline int cddl_float(cddl_cursor_t *C, double *Value) {
+	minicbor_view_t View = {C->Next, C->Limit};
+	uint64_t Bits;
+	if (C->Next == C->Limit || !MINICBOR(view_float)(View, Value)) return 0;
+	C->Next += MINICBOR(decode_head)(C->Next, C->Limit - C->Next, &Bits);
+	return 1;
+}
+
+static inline int cddl_bool(cddl_cursor_t *C, int *Value) {
+	if (C->Next == C->Limit || (C->Next[0] | 1) != 0xF5) return 0;
+	*Value = *C->Next++ & 1;
+	return 1;
+}
+
+/*
+ * Only definite strings are accepted, the cursor is left unchanged otherwise so that unexpected keys can be skipped.
+ */
+static inline int cddl_string(cddl_cursor_t *C, unsigned char Major, const unsigned char **Bytes, size_t *Size) {
+	const unsigned char *Head = C->Next;
+	uint64_t Length;
+	if (!cddl_head(C, Major, &Length) || Length > (uint64_t)(C->Limit - C->Next)) {
+		C->Next = Head;
+		return 0;
+	}
+	*Bytes = C->Next;
+	*Size = Length;
+	C->Next += Length;
+	return 1;
+}
+
+static inline int cddl_text(cddl_cursor_t *C, minicbor_cddl_text_t *Text) {
+	return cddl_string(C, 3, (const unsigned char **)&Text->Data, &Text->Length);
+}
+
+static inline int cddl_bytes(cddl_cursor_t *C, minicbor_cddl_bytes_t *Bytes) {
+	return cddl_string(C, 2, &Bytes->Data, &Bytes->Size);
+}
+
+static inline int cddl_write_view(minicbor_buffer_writer_t *Writer, minicbor_view_t View) {
+	const unsigned char *Bytes;
+	size_t Size;
+	if (!MINICBOR(view_encoded)(View, &Bytes, &Size)) return -1;
+	return MINICBOR(buffer_write_data)(Writer, Bytes, Size);
+}
+'''
+
+DECODERS = {
+	"uint": "cddl_uint",
+	"nint": "cddl_nint",
+	"int": "cddl_int",
+	"float": "cddl_float",
+	"float16": "cddl_float",
+	"float32": "cddl_float",
+	"float64": "cddl_float",
+	"tstr": "cddl_text",
+	"text": "cddl_text",
+	"bstr": "cddl_bytes",
+	"bytes": "cddl_bytes",
+	"bool": "cddl_bool",
+	"any": "cddl_any"
+}
+
+class Generator:
+	def __init__(self, Schema, Source, Base):
+		self.Schema = Schema
+		self.Source = Source
+		self.Base = Base
+
+	def declaration(self, Field):
+		Type = Field["type"]
+		Name = Field["name"]
+		if Type[0] == "prim": return [f"{PRIMITIVES[Type[1]]} {Name};"]
+		if Type[0] == "struct": return [f"{Type[1]}_t {Name};"]
+		if Type[0] == "view": return [f"minicbor_view_t {Name};"]
+		Item = Type[1]
+		ItemType = PRIMITIVES[Item[1]] if Item[0] == "prim" else f"{Item[1]}_t"
+		return [f"{ItemType} {Name}[{Type[3]}];", f"size_t {Name}_count;"]
+
+	def header(self):
+		Guard = c_name(os.path.basename(self.Base)).upper() + "_H"
+		Lines = [
+			f"#ifndef {Guard}",
+			f"#define {Guard}",
+			"",
+			f"/* Generated by minicbor_cddl.py from {os.path.basename(self.Source)}, do not edit. */",
+			"",
+			'#include "minicbor.h"',
+			'#include "minicbor_view.h"',
+			"",
+			"#ifdef __cplusplus",
+			'extern "C" {',
+			"#endif",
+			"",
+			"#ifndef MINICBOR_CDDL_TYPES",
+			"#define MINICBOR_CDDL_TYPES",
+			"",
+			"typedef struct {",
+			"\tconst char *Data;",
+			"\tsize_t Length;",
+			"} minicbor_cddl_text_t;",
+			"",
+			"typedef struct {",
+			"\tconst unsigned char *Data;",
+			"\tsize_t Size;",
+			"} minicbor_cddl_bytes_t;",
+			"",
+			"#endif",
+			""
+		]
+		for Name in self.Schema.Order:
+			Struct = self.Schema.Structs[Name]
+			Lines.append("typedef struct {")
+			for Field in Struct["fields"]:
+				Lines.extend("\t" + Line for Line in self.declaration(Field))
+			for Field in Struct["fields"]:
+				if Field["optional"]: Lines.append(f"\tint has_{Field['name']};")
+			Lines.append(f"}} {Name}_t;")
+			Lines.append("")
+		for Name in self.Schema.Order:
+			Lines.append("/**")
+			Lines.append(f" * Decodes the first item in :code:`Bytes` into :code:`Value`, strings and views point into :code:`Bytes`.")
+			Lines.append(" * Returns :code:`0` on success, :code:`-1` if the input is invalid or does not match the schema, or :code:`-2` if a required key is missing.")
+			Lines.append(" */")
+			Lines.append(f"int {Name}_decode({Name}_t *Value, const void *Bytes, size_t Size);")
+			Lines.append("")
+			Lines.append("/**")
+			Lines.append(" * Encodes :code:`Value`, with map keys in bytewise lexicographic order of their encodings.")
+			Lines.append(" * Returns :code:`0`, or the negative value returned by the writer.")
+			Lines.append(" */")
+			Lines.append(f"int {Name}_encode(minicbor_buffer_writer_t *Writer, const {Name}_t *Value);")
+			Lines.append("")
+		Lines.extend(["#ifdef __cplusplus", "}", "#endif", "", "#endif"])
+		return "\n".join(Lines) + "\n"
+
+	def decode_item(self, Type, Target, Indent, Uses):
+		Tabs = "\t" * Indent
+		if Type[0] == "prim": return [f"{Tabs}if (!{DECODERS[Type[1]]}(C, &{Target})) return -1;"]
+		if Type[0] == "view": return [f"{Tabs}if (!cddl_array(C, &{Target})) return -1;"]
+		if Type[0] == "struct":
+			Uses.add("Status")
+			return [f"{Tabs}if ((Status = {Type[1]}_read(C, &{Target}))) return Status;"]
+		_, Item, Min, Max = Type
+		Lines = [
+			f"{Tabs}{{",
+			f"{Tabs}\tuint64_t Items;",
+			f"{Tabs}\tsize_t Item = 0;",
+			f"{Tabs}\tif (!cddl_container(C, 4, &Items)) return -1;",
+			f"{Tabs}\tfor (; Items == UINT64_MAX ? !cddl_break(C) : Item < Items; ++Item) {{",
+			f"{Tabs}\t\tif (Item == {Max}) return -1;"
+		]
+		Lines.extend(self.decode_item(Item, f"{Target}[Item]", Indent + 2, Uses))
+		Lines.append(f"{Tabs}\t}}")
+		if Min: Lines.append(f"{Tabs}\tif (Item < {Min}) return -1;")
+		Lines.append(f"{Tabs}\t{Target}_count = Item;")
+		Lines.append(f"{Tabs}}}")
+		return Lines
+
+	def decode_field(self, Field, Bit, Indent, Uses):
+		Tabs = "\t" * Indent
+		Lines = self.decode_item(Field["type"], f"Value->{Field['name']}", Indent, Uses)
+		if Field["optional"]:
+			Lines.append(f"{Tabs}Value->has_{Field['name']} = 1;")
+		else:
+			Lines.append(f"{Tabs}Seen |= {1 << Bit:#x}ull;")
+		Lines.append(f"{Tabs}continue;")
+		return Lines
+
+	def reader(self, Name):
+		Struct = self.Schema.Structs[Name]
+		Fields = Struct["fields"]
+		Uses = set()
+		Body = []
+		if Struct["kind"] == "array":
+			Body.append("\tuint64_t Count;")
+			Body.append(f"\tif (!cddl_container(C, 4, &Count) || (Count != {len(Fields)} && Count != UINT64_MAX)) return -1;")
+			for Field in Fields:
+				Body.extend(self.decode_item(Field["type"], f"Value->{Field['name']}", 1, Uses))
+			Body.append("\tif (Count == UINT64_MAX && !cddl_break(C)) return -1;")
+			Body.append("\treturn 0;")
+		else:
+			Required = 0
+			Bits = {}
+			for Field in Fields:
+				if not Field["optional"]:
+					Bits[Field["name"]] = Required
+					Required += 1
+			Body.append("\tuint64_t Count;")
+			if Required: Body.append("\tuint64_t Seen = 0;")
+			Body.append("\tif (!cddl_container(C, 5, &Count)) return -1;")
+			for Field in Fields:
+				if Field["optional"]: Body.append(f"\tValue->has_{Field['name']} = 0;")
+			Body.append("\tfor (uint64_t Index = 0; Count == UINT64_MAX ? !cddl_break(C) : Index < Count; ++Index) {")
+			Body.append("\t\tif (C->Next == C->Limit) return -1;")
+			Body.append("\t\tswitch (C->Next[0] >> 5) {")
+			Texts = [Field for Field in Fields if isinstance(Field["key"], str)]
+			for Major in (0, 1):
+				Ints = [Field for Field in Fields if isinstance(Field["key"], int) and (Field["key"] < 0) == Major]
+				if not Ints: continue
+				Body.append(f"\t\tcase {Major}: {{")
+				Body.append("\t\t\tuint64_t Key;")
+				Body.append(f"\t\t\tif (!cddl_head(C, {Major}, &Key)) return -1;")
+				Body.append("\t\t\tswitch (Key) {")
+				for Field in sorted(Ints, key = lambda Field: abs(Field["key"])):
+					Key = Field["key"] if not Major else -1 - Field["key"]
+					Body.append(f"\t\t\tcase {Key}ull:")
+					Body.extend(self.decode_field(Field, Bits.get(Field["name"]), 4, Uses))
+				Body.append("\t\t\t}")
+				Body.append("\t\t\tbreak;")
+				Body.append("\t\t}")
+			if Texts:
+				Body.append("\t\tcase 3: {")
+				Body.append("\t\t\tminicbor_cddl_text_t Key;")
+				Body.append("\t\t\tif (!cddl_text(C, &Key)) {")
+				Body.append("\t\t\t\tif (!cddl_skip(C)) return -1;")
+				Body.append("\t\t\t\tbreak;")
+				Body.append("\t\t\t}")
+				Body.append("\t\t\tswitch (Key.Length) {")
+				Lengths = {}
+				for Field in Texts: Lengths.setdefault(len(Field["key"].encode("utf-8")), []).append(Field)
+				for Length in sorted(Lengths):
+					Body.append(f"\t\t\tcase {Length}:")
+					for Field in Lengths[Length]:
+						Key = Field["key"].encode("utf-8")
+						Body.append(f"\t\t\t\tif (!memcmp(Key.Data, {c_bytes(Key)}, {Length})) {{")
+						Body.extend(self.decode_field(Field, Bits.get(Field["name"]), 5, Uses))
+						Body.append("\t\t\t\t}")
+					Body.append("\t\t\t\tbreak;")
+				Body.append("\t\t\t}")
+				Body.append("\t\t\tbreak;")
+				Body.append("\t\t}")
+			Body.append("\t\tdefault:")
+			Body.append("\t\t\tif (!cddl_skip(C)) return -1;")
+			Body.append("\t\t\tbreak;")
+			Body.append("\t\t}")
+			Body.append("\t\t// Unknown keys are skipped along with their values")
+			Body.append("\t\tif (!cddl_skip(C)) return -1;")
+			Body.append("\t}")
+			if Required:
+				Mask = (1 << Required) - 1
+				Body.append(f"\tif (Seen != {Mask:#x}ull) return -2;")
+			Body.append("\treturn 0;")
+		Lines = [f"static int {Name}_read(cddl_cursor_t *C, {Name}_t *Value) {{"]
+		if "Status" in Uses: Lines.append("\tint Status;")
+		Lines.extend(Body)
+		Lines.append("}")
+		return Lines
+
+	def encode_item(self, Type, Source, Indent):
+		Tabs = "\t" * Indent
+		def call(Expression):
+			return f"{Tabs}if ((Status = {Expression})) return Status;"
+		if Type[0] == "prim":
+			Prim = Type[1]
+			if Prim == "uint": return [call(f"MINICBOR(buffer_write_positive)(Writer, {Source})")]
+			if Prim in ("int", "nint"): return [call(f"MINICBOR(buffer_write_integer)(Writer, {Source})")]
+			if Prim == "float": return [call(f"MINICBOR(buffer_write_float)(Writer, {Source})")]
+			if Prim == "float16": return [call(f"MINICBOR(buffer_write_float2)(Writer, {Source})")]
+			if Prim == "float32": return [call(f"MINICBOR(buffer_write_float4)(Writer, {Source})")]
+			if Prim == "float64": return [call(f"MINICBOR(buffer_write_float8)(Writer, {Source})")]
+			if Prim in ("tstr", "text"):
+				return [
+					call(f"MINICBOR(buffer_write_string)(Writer, {Source}.Length)"),
+					call(f"MINICBOR(buffer_write_data)(Writer, {Source}.Data, {Source}.Length)")
+				]
+			if Prim in ("bstr", "bytes"):
+				return [
+					call(f"MINICBOR(buffer_write_bytes)(Writer, {Source}.Size)"),
+					call(f"MINICBOR(buffer_write_data)(Writer, {Source}.Data, {Source}.Size)")
+				]
+			if Prim == "bool": return [call(f"MINICBOR(buffer_write_simple)(Writer, {Source} ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE)")]
+			return [call(f"cddl_write_view(Writer, {Source})")]
+		if Type[0] == "view": return [call(f"cddl_write_view(Writer, {Source})")]
+		if Type[0] == "struct": return [call(f"{Type[1]}_encode(Writer, &{Source})")]
+		Lines = [
+			call(f"MINICBOR(buffer_write_array)(Writer, {Source}_count)"),
+			f"{Tabs}for (size_t Item = 0; Item < {Source}_count; ++Item) {{"
+		]
+		Lines.extend(self.encode_item(Type[1], f"{Source}[Item]", Indent + 1))
+		Lines.append(f"{Tabs}}}")
+		return Lines
+
+	def writer(self, Name):
+		Struct = self.Schema.Structs[Name]
+		Fields = Struct["fields"]
+		Lines = [f"int {Name}_encode(minicbor_buffer_writer_t *Writer, const {Name}_t *Value) {{", "\tint Status;"]
+		if Struct["kind"] == "array":
+			Lines.append(f"\tif ((Status = MINICBOR(buffer_write_array)(Writer, {len(Fields)}))) return Status;")
+			for Field in Fields:
+				Lines.extend(self.encode_item(Field["type"], f"Value->{Field['name']}", 1))
+		else:
+			Size = [str(sum(not Field["optional"] for Field in Fields))]
+			Size.extend(f"!!Value->has_{Field['name']}" for Field in Fields if Field["optional"])
+			Lines.append(f"\tif ((Status = MINICBOR(buffer_write_map)(Writer, {' + '.join(Size)}))) return Status;")
+			for Field in sorted(Fields, key = lambda Field: encode_key(Field["key"])):
+				Key = encode_key(Field["key"])
+				Indent = 1
+				if Field["optional"]:
+					Lines.append(f"\tif (Value->has_{Field['name']}) {{")
+					Indent = 2
+				Tabs = "\t" * Indent
+				Lines.append(f"{Tabs}if ((Status = MINICBOR(buffer_write_data)(Writer, {c_bytes(Key)}, {len(Key)}))) return Status;")
+				Lines.extend(self.encode_item(Field["type"], f"Value->{Field['name']}", Indent))
+				if Field["optional"]: Lines.append("\t}")
+		Lines.append("\treturn 0;")
+		Lines.append("}")
+		return Lines
+
+	def source(self):
+		Lines = [
+			f"/* Generated by minicbor_cddl.py from {os.path.basename(self.Source)}, do not edit. */",
+			"",
+			f'#include "{os.path.basename(self.Base)}.h"',
+			"#include <string.h>",
+			PRELUDE.rstrip("\n")
+		]
+		for Name in self.Schema.Order:
+			Lines.append("")
+			Lines.extend(self.reader(Name))
+			Lines.append("")
+			Lines.append(f"int {Name}_decode({Name}_t *Value, const void *Bytes, size_t Size) {{")
+			Lines.append("\tcddl_cursor_t C = {(const unsigned char *)Bytes, (const unsigned char *)Bytes + Size};")
+			Lines.append(f"\treturn {Name}_read(&C, Value);")
+			Lines.append("}")
+			Lines.append("")
+			Lines.extend(self.writer(Name))
+		return "\n".join(Lines) + "\n"
+
+def main():
+	Arguments = argparse.ArgumentParser(description = "Generates C decoders and encoders from a CDDL schema.")
+	Arguments.add_argument("schema")
+	Arguments.add_argument("-o", "--output", help = "output base name, writes <output>.h and <output>.c")
+	Arguments.add_argument("-p", "--prefix", default = "", help = "prefix for generated types and functions")
+	Arguments = Arguments.parse_args()
+	Base = Arguments.output or os.path.splitext(Arguments.schema)[0] + "_cbor"
+	try:
+		with open(Arguments.schema, encoding = "utf-8") as File: Source = File.read()
+		Generated = Generator(Schema(Parser(tokenize(Source)).rules(), Arguments.prefix), Arguments.schema, Base)
+		Header, Code = Generated.header(), Generated.source()
+	except SchemaError as Error:
+		sys.exit(f"{Arguments.schema}: {Error}")
+	with open(Base + ".h", "w") as File: File.write(Header)
+	with open(Base + ".c", "w") as File: File.write(Code)
+
+if __name__ == "__main__":
+	main()